@@ -0,0 +1,79 @@
+#pragma once
+#include "ecs_type.h"
+
+/*
+    Structural changes recorded while the world is deferred.
+    Every thread owns one buffer, they are merged at the sync point.
+    Command data lives in blocks that never move, so stored objects keep their address
+*/
+
+namespace ECS
+{
+    enum class CommandType : uint32_t
+    {
+        CreateEntity,
+        AddComponent,
+        RemoveComponent,
+        Set,
+        EnableComponent,
+        DisableComponent,
+        DestroyEntity
+    };
+
+    struct Command
+    {
+        EntityId entity;
+        EntityId id;
+        void* data;
+        CommandType type;
+    };
+
+    constexpr uint32_t CommandBufferDefaultCapacity = 64;
+    constexpr uint32_t CommandDataBlockSize = KB(16);
+
+    struct CommandDataBlock
+    {
+        CommandDataBlock* next;
+        uint32_t size;
+        uint32_t used;
+    };
+
+    class CommandBuffer
+    {
+    public:
+        CommandBuffer()
+            : m_commands(nullptr), m_count(0), m_capacity(0),
+            m_blockHead(nullptr), m_block(nullptr)
+        {
+        }
+
+        void Init();
+        void Destroy();
+
+        void Push(CommandType type, EntityId entity, EntityId id, void* data = nullptr);
+        void* PushData(uint32_t size, uint32_t alignment);
+
+        //keeps the memory for the next frame
+        void Clear();
+
+        uint32_t GetCount() const
+        {
+            return m_count;
+        }
+
+        Command* GetCommands()
+        {
+            return m_commands;
+        }
+
+    private:
+        CommandDataBlock* CreateBlock(uint32_t size);
+
+    private:
+        Command* m_commands;
+        uint32_t m_count;
+        uint32_t m_capacity;
+        CommandDataBlock* m_blockHead;
+        CommandDataBlock* m_block;
+    };
+}
@@ -3,9 +3,11 @@
 
 namespace ECS
 {
+    class BlockAllocator;
 
 constexpr uint32_t MinChunkCount = 1;
 constexpr uint32_t MinChunkAlign = 16;
+constexpr uint32_t MaxChunkAlign = 64; //chunks are aligned to their size up to a cache line
 constexpr uint32_t PageSize = KB(4);
 
     struct BlockAllocatorChunk
@@ -13,9 +15,13 @@ constexpr uint32_t PageSize = KB(4);
         BlockAllocatorChunk* next;
     };
 
-    struct BlockAllocatorBlock
+    /*
+        Header at the start of every block, blocks are aligned to their size
+        so a chunk finds its header by masking its address
+    */
+    struct alignas(MinChunkAlign) BlockAllocatorBlock
     {
-        void* firstChunk;
+        BlockAllocator* owner;
         BlockAllocatorBlock* next;
     };
 
@@ -25,12 +31,13 @@ constexpr uint32_t PageSize = KB(4);
         friend class WorldAllocator;
 
         BlockAllocator()
-            : m_allocCount(0), m_chunkCount(0), m_chunkSize(0), m_blockSize(0),
+            : m_allocCount(0), m_chunkCount(0), m_chunkSize(0), m_blockSize(0), m_chunkOffset(0),
             m_chunkHead(nullptr), m_blockHead(nullptr)
         {
         }
 
         void Init(uint32_t dataSize);
+        void Init(uint32_t dataSize, uint32_t chunkCount);
         void* Alloc();
         void* Calloc();
         void Free(void* addr);
@@ -38,12 +45,14 @@ constexpr uint32_t PageSize = KB(4);
 
     private:
         BlockAllocatorChunk* CreateBlock();
+        void InitBlockSize();
 
     private:
         uint32_t m_allocCount;
         uint32_t m_chunkCount;
         uint32_t m_chunkSize;
         uint32_t m_blockSize;
+        uint32_t m_chunkOffset; //first chunk after the header
         BlockAllocatorChunk* m_chunkHead;
         BlockAllocatorBlock* m_blockHead;
     };
@@ -0,0 +1,45 @@
+#pragma once
+#include "../ecs_pch.h"
+
+/*
+    Column that reserves its whole address range up front and commits pages as it grows,
+    the data never moves so growing is zero copy.
+    Committed ranges past HugePageSize are advised for transparent huge pages on linux
+*/
+
+namespace ECS
+{
+    constexpr uint64_t ColumnArenaReserveSize = 1ULL << 30;
+    constexpr uint64_t ColumnArenaPageSize = KB(4);
+    constexpr uint64_t HugePageSize = MB(2);
+
+    class ColumnArena
+    {
+    public:
+        ColumnArena()
+            : m_base(nullptr), m_reserved(0), m_committed(0)
+        {
+        }
+
+        void Init(uint64_t reserveSize = ColumnArenaReserveSize);
+        void Destroy();
+
+        //commits at least size bytes, rounded up to a power of 2 of pages
+        void Commit(uint64_t size);
+
+        void* GetData() const
+        {
+            return m_base;
+        }
+
+        uint64_t GetCommitted() const
+        {
+            return m_committed;
+        }
+
+    private:
+        void* m_base;
+        uint64_t m_reserved;
+        uint64_t m_committed;
+    };
+}
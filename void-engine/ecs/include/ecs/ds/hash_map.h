@@ -291,70 +291,24 @@ namespace ECS
 
         bool ContainsKey(const Key& key) const
         {
-            size_t index = Hash<Key>::Value(key) % m_bucketCount;
-            Bucket* bucket = nullptr;
-            uint32_t PSL = 0;
-
-            //linear probing
-            while(true)
-            {
-                bucket = CAST_OFFSET_ELEMENT(m_array, Bucket, sizeof(Bucket), (index % m_bucketCount));
-                if(bucket->occupied)
-                {
-                    if(PSL > bucket->PSL)
-                    {
-                        break;
-                    }
-
-                    if(KeyCast(bucket) == key)
-                    {
-                        return true;
-                    }
-                }
-                else
-                {
-                    break;
-                }
-
-                ++PSL;
-                ++index;
-            }
-
-            return false;
+            return FindBucket(key) != nullptr;
         }
 
         Value& GetValue(const Key& key)
         {
-            size_t index = Hash<Key>::Value(key) % m_bucketCount;
-            Bucket* bucket = nullptr;
-            uint32_t PSL = 0;
+            Bucket* bucket = FindBucket(key);
 
-            //linear probing
-            while(true)
-            {
-                bucket = CAST_OFFSET_ELEMENT(m_array, Bucket, sizeof(Bucket), (index % m_bucketCount));
-                if(bucket->occupied)
-                {
-                    if(PSL > bucket->PSL)
-                    {
-                        break;
-                    }
+            assert(bucket && "No key exist!");
 
-                    if(KeyCast(bucket) == key)
-                    {
-                        return ValueCast(bucket);
-                    }
-                }
-                else
-                {
-                    break;
-                }
+            return ValueCast(bucket);
+        }
 
-                PSL++;
-                index++;
-            }
+        //single probe lookup, null when the key is missing
+        Value* TryGetValue(const Key& key)
+        {
+            Bucket* bucket = FindBucket(key);
 
-            assert(0 && "No key exist!");
+            return bucket ? &ValueCast(bucket) : nullptr;
         }
 
         bool Empty() const
@@ -388,6 +342,40 @@ namespace ECS
         }
 
     private:
+        Bucket* FindBucket(const Key& key) const
+        {
+            size_t index = Hash<Key>::Value(key) % m_bucketCount;
+            Bucket* bucket = nullptr;
+            uint32_t PSL = 0;
+
+            //linear probing
+            while(true)
+            {
+                bucket = CAST_OFFSET_ELEMENT(m_array, Bucket, sizeof(Bucket), (index % m_bucketCount));
+                if(bucket->occupied)
+                {
+                    if(PSL > bucket->PSL)
+                    {
+                        break;
+                    }
+
+                    if(KeyCast(bucket) == key)
+                    {
+                        return bucket;
+                    }
+                }
+                else
+                {
+                    break;
+                }
+
+                ++PSL;
+                ++index;
+            }
+
+            return nullptr;
+        }
+
         void* CallocN(uint32_t capacity)
         {
             void* data = nullptr;
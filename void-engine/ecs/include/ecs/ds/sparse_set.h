@@ -16,12 +16,17 @@ namespace ECS
         T* data;
     };
 
+    /*
+        Dense holds the alive ids first, from 1 to count, then the dead ids when reused.
+        A dead id keeps its dense index so it can be revived in place, the page index
+        of an id is alive while it points at or below count
+    */
     template<typename T>
     class SparseSet
     {
     public:
         SparseSet()
-            : m_dense(), m_sparse(), m_count(0), m_reuseId(false),
+            : m_dense(), m_sparse(), m_count(0), m_maxId(0), m_reuseId(false),
             m_allocator(nullptr), m_pageAllocator(nullptr)
         {
             static_assert(
@@ -45,9 +50,24 @@ namespace ECS
             return m_count;
         }
 
+        //highest low id ever pushed, ids above it were never used
+        uint32_t GetMaxId() const
+        {
+            return m_maxId;
+        }
+
         bool isValidDense(uint64_t id);
         bool isValidPage(uint64_t id);
 
+        //read only, never allocates a page. safe while other threads read the set
+        bool Contains(uint64_t id);
+
+        //read only as Contains, null when the id is missing
+        T* TryGetPageData(uint64_t id);
+
+        //read only, the generation of the id must match the alive one
+        bool IsAlive(uint64_t id);
+
         uint64_t GetId(uint32_t denseIndex)
         {
             if(denseIndex >= m_dense.GetCount())
@@ -72,8 +92,12 @@ namespace ECS
         uint32_t GetPageOffset(uint32_t id);
         
         //this will grow dense and sparse if needed
+        //a dead id is revived in place and keeps the generation of the pushed id
         template<typename U>
-        uint32_t PushBack(uint64_t id, U&& element, bool newId = true);
+        uint32_t PushBack(uint64_t id, U&& element);
+
+        //grows dense once for count new ids
+        void Reserve(uint32_t count);
 
         void AllocPage(SparsePage<T>* page);
         void CallocPageDenseIndex(SparsePage<T>* page);
@@ -99,6 +123,7 @@ namespace ECS
         WorldAllocator* m_allocator;
         BlockAllocator* m_pageAllocator;
         uint32_t m_count; //Alive id
+        uint32_t m_maxId;
         bool m_reuseId;
     };
 
@@ -11,6 +11,8 @@ namespace ECS
 
         defaultDense = defaultDense == 0 ? 1 : defaultDense;
 
+        m_maxId = 0;
+
         m_dense.Init(allocator, sizeof(uint64_t), defaultDense);
         m_sparse.Init(allocator, sizeof(SparsePage<T>), 0);
 
@@ -154,23 +156,27 @@ namespace ECS
 
     template<typename T>
     template<typename U>
-    uint32_t SparseSet<T>::PushBack(uint64_t id, U&& element, bool newId)
+    uint32_t SparseSet<T>::PushBack(uint64_t id, U&& element)
     {
         uint32_t lowId = CAST(id, uint32_t);
 
-        uint32_t pageIndex = GetPageIndex(lowId);
         uint32_t pageOffset = GetPageOffset(lowId);
 
         SparsePage<T>* page = CreateOrGetSparsePage(lowId);
 
         uint32_t denseIndex = page->denseIndex[pageOffset];
-        
+
+        if(denseIndex != 0 && denseIndex <= m_count)
+        {
+            std::cout << "Id exist!" << std::endl;
+            return 0;
+        }
+
+        uint32_t nextAliveCount = m_count + 1;
+
+        //never pushed, appended after the dead ids
         if(denseIndex == 0)
         {
-            uint64_t freeId = 0;
-            uint32_t nextAliveCount = m_count + 1;
-            uint32_t denseCount = m_dense.GetCount();
-           
             if(m_dense.IsReqGrow())
             {
                 void* oldDense = m_dense.GetArray();
@@ -179,7 +185,7 @@ namespace ECS
                 //NOTE: consider this approach. 
                 //Allocator null make dense allocate ineffciently by increasing just 1
                 m_dense.Grow(m_allocator, m_dense.GetCapacity() + 1);
-                
+
                 std::memcpy(m_dense.GetArray(), oldDense, oldDenseSize);
 
                 if(oldDense)
@@ -195,38 +201,56 @@ namespace ECS
                 }
             }
 
-            /*
-                The dense can have pool of free ID
-                Dense must support add new ID, or reused ID
-            */
+            denseIndex = m_dense.GetCount();
+            PTR_CAST(m_dense.GetFirstElement(), uint64_t)[denseIndex] = id;
+            m_dense.IncreCount();
+            page->denseIndex[pageOffset] = denseIndex;
+        }
 
-            if(newId)
-            {
-                if(denseCount > nextAliveCount)
-                {
-                    PTR_CAST(m_dense.GetFirstElement(), uint64_t)[denseCount] = id;
-                    m_dense.IncreCount();
-                    SwapDense(denseCount, nextAliveCount, false);
-                }
-                else
-                {
-                    PTR_CAST(m_dense.GetFirstElement(), uint64_t)[nextAliveCount] = id;
-                    m_dense.IncreCount();
-                
-                }
-            }
+        //the first dead slot becomes alive
+        if(denseIndex != nextAliveCount)
+        {
+            SwapDense(denseIndex, nextAliveCount, true);
+        }
+
+        //a reused id comes back with the generation it was pushed with
+        PTR_CAST(m_dense.GetFirstElement(), uint64_t)[nextAliveCount] = id;
 
-            page->denseIndex[pageOffset] = nextAliveCount;
-            new (GetPageData(lowId)) T(std::move(element));
+        ++m_count;
+        new (GetPageData(lowId)) T(std::move(element));
 
-            ++m_count;
+        m_maxId = std::max(m_maxId, lowId);
 
-            return nextAliveCount;
+        return nextAliveCount;
+    }
+
+    template<typename T>
+    void SparseSet<T>::Reserve(uint32_t count)
+    {
+        uint32_t newCapacity = m_dense.GetCount() + count;
+
+        if(newCapacity <= m_dense.GetCapacity())
+        {
+            return;
         }
-        else
+
+        void* oldDense = m_dense.GetArray();
+        uint32_t oldDenseSize = m_dense.GetElementSize() * m_dense.GetCapacity();
+
+        m_dense.Grow(m_allocator, newCapacity);
+
+        std::memcpy(m_dense.GetArray(), oldDense, oldDenseSize);
+
+        if(oldDense)
         {
-            std::cout << "Id exist!" << std::endl;
-            return 0;
+            if(m_allocator)
+            {
+                m_allocator->Free(oldDenseSize, oldDense);
+            }
+            else
+            {
+                std::free(oldDense);
+            }
         }
     }
 
@@ -250,7 +274,67 @@ namespace ECS
 
         uint32_t denseIndex = page->denseIndex[GetPageOffset(lowId)];
 
-        return denseIndex != 0;
+        return denseIndex != 0 && denseIndex <= m_count;
+    }
+
+    template<typename T>
+    bool SparseSet<T>::Contains(uint64_t id)
+    {
+        uint32_t lowId = CAST(id, uint32_t);
+        uint32_t pageIndex = GetPageIndex(lowId);
+
+        if(lowId == 0 || m_sparse.GetCount() < pageIndex + 1)
+        {
+            return false;
+        }
+
+        auto page = CAST_OFFSET_MEM_ARR_ELEMENT(m_sparse, pageIndex, SparsePage<T>);
+
+        if(!page->denseIndex)
+        {
+            return false;
+        }
+
+        uint32_t denseIndex = page->denseIndex[GetPageOffset(lowId)];
+
+        return denseIndex != 0 && denseIndex <= m_count;
+    }
+
+    template<typename T>
+    bool SparseSet<T>::IsAlive(uint64_t id)
+    {
+        if(!Contains(id))
+        {
+            return false;
+        }
+
+        auto page = CAST_OFFSET_MEM_ARR_ELEMENT(m_sparse, GetPageIndex(CAST(id, uint32_t)), SparsePage<T>);
+        uint32_t denseIndex = page->denseIndex[GetPageOffset(CAST(id, uint32_t))];
+
+        return PTR_CAST(m_dense.GetArray(), uint64_t)[denseIndex] == id;
+    }
+
+    template<typename T>
+    T* SparseSet<T>::TryGetPageData(uint64_t id)
+    {
+        uint32_t lowId = CAST(id, uint32_t);
+        uint32_t pageIndex = GetPageIndex(lowId);
+
+        if(m_sparse.GetCount() < pageIndex + 1)
+        {
+            return nullptr;
+        }
+
+        auto page = CAST_OFFSET_MEM_ARR_ELEMENT(m_sparse, pageIndex, SparsePage<T>);
+        uint32_t pageOffset = GetPageOffset(lowId);
+
+        if(!page->denseIndex || !page->data ||
+           page->denseIndex[pageOffset] == 0 || page->denseIndex[pageOffset] > m_count)
+        {
+            return nullptr;
+        }
+
+        return CAST_OFFSET_ELEMENT(page->data, T, sizeof(T), pageOffset);
     }
 
     template<typename T>
@@ -278,7 +362,7 @@ namespace ECS
 
         uint32_t denseIndex = page->denseIndex[GetPageOffset(lowId)];
 
-        if(page->data && denseIndex != 0)
+        if(page->data && denseIndex != 0 && denseIndex <= m_count)
         {
             return CAST_OFFSET_ELEMENT(page->data, T, sizeof(T), GetPageOffset(lowId));
         }
@@ -305,47 +389,34 @@ namespace ECS
         }
 
         uint32_t denseIndex = page->denseIndex[GetPageOffset(lowId)];
-        
-        if(denseIndex == 0)
+
+        if(denseIndex == 0 || denseIndex > m_count)
         {
             return;
         }
 
-        if(m_count > 1){
-            if(m_reuseId)
-            {
-                if(denseIndex != m_count)
-                {
-                    SwapDense(denseIndex, m_count, true);
-                }
-            }
-            else
-            {
-                if(denseIndex != m_dense.GetCount() - 1)
-                {
-                    SwapDense(denseIndex, m_dense.GetCount() - 1, true);
-                }
-                m_dense.DecreCount();
-            }
+        T* data = GetPageData(lowId);
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            data->~T();
         }
-        else
+
+        //the last alive id fills the hole
+        if(denseIndex != m_count)
         {
-            if(m_reuseId)
-            {
-            }
-            else
-            {
-                m_dense.DecreCount();
-            }
+            SwapDense(denseIndex, m_count, true);
         }
 
-        T* data = GetPageData(lowId);        
-        if constexpr (!std::is_trivially_destructible_v<T>)
+        if(m_reuseId)
         {
-            data->~T();
+            //kept as the first dead id, its page index still points at it
+        }
+        else
+        {
+            m_dense.DecreCount();
+            page->denseIndex[GetPageOffset(lowId)] = 0;
         }
 
-        page->denseIndex[GetPageOffset(lowId)] = 0;
         --m_count;
     }
 
@@ -6,17 +6,42 @@
 
 /*
     Allocator for each requested size
+    Sizes up to CachedMaxSize go through a cache owned by the calling thread,
+    the shared size classes are only locked to refill or return a batch of chunks.
+    Larger sizes are malloc'd directly.
+    Every allocation is aligned to its power of 2 size, up to MaxChunkAlign
 */
 
 namespace ECS
 {
 
     constexpr uint32_t WorldAllocDefaultDense = 64;
+    constexpr uint32_t CachedMinSize = 16;
+    constexpr uint32_t CachedMaxSize = PageSize / 2;
+    constexpr uint32_t CachedClassCount = 8; //16 to 2048 bytes
+    constexpr uint32_t MagazineCapacity = 64;
+    constexpr uint32_t MagazineBatch = MagazineCapacity / 2;
+
+    struct AllocatorMagazine
+    {
+        void* chunks[MagazineCapacity];
+        uint32_t count;
+    };
+
+    //one per job system thread, aligned so two threads never share a cache line
+    struct alignas(64) AllocatorThreadCache
+    {
+        AllocatorMagazine magazines[CachedClassCount];
+    };
 
     class WorldAllocator
     {
     public:
         void Init();
+        void Destroy();
+
+        //caches are indexed by JobSystem::GetThreadIndex, the chunks of old caches are returned first
+        void SetThreadCount(uint32_t threadCount);
 
         void* Alloc(uint32_t size);
         void* AllocN(uint32_t elementSize, uint32_t capacity, uint32_t& expandedCapacity);
@@ -26,10 +51,22 @@ namespace ECS
 
         BlockAllocator* GetOrCreateBalloc(uint32_t size);
 
+    private:
+        void* CacheAlloc(uint32_t alignedSize);
+        void CacheFree(uint32_t alignedSize, void* addr);
+        void Refill(uint32_t classIdx, AllocatorMagazine& magazine);
+        void Return(uint32_t classIdx, AllocatorMagazine& magazine, uint32_t count);
+        void DestroyThreadCaches();
 
     public:
         BlockAllocator m_chunks;
         SparseSet<BlockAllocator> m_sparse;
+
+    private:
+        BlockAllocator* m_classes[CachedClassCount];
+        std::mutex m_classLocks[CachedClassCount];
+        AllocatorThreadCache* m_threadCaches;
+        uint32_t m_threadCount;
     };
 }
 
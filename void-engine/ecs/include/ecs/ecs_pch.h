@@ -18,5 +18,17 @@
 #include <set>
 #include <unordered_set>
 #include <typeinfo>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 #include "ecs_utils.h"
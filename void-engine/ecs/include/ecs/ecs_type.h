@@ -1,6 +1,8 @@
 #pragma once
 #include "ecs_pch.h"
 #include "ds/hash_map.h"
+#include "ds/column_arena.h"
+#include "soa.h"
 
 
 template<typename T>
@@ -126,100 +128,131 @@ namespace ECS
         }
     };
 
+    constexpr uint32_t ComponentSetInlineCount = 8;
+
+    /*
+        Sorted component ids, used as archetype type and lookup key.
+        Up to ComponentSetInlineCount ids are stored inline so small keys never allocate,
+        copies share a heap array but always carry their own inline ids.
+        The hash is order dependent and cached until the ids are sorted or reallocated
+    */
     struct ComponentSet
     {
         EntityId* idArr;
         uint32_t count;
+        mutable uint64_t hash; //0 until computed
+        EntityId inlineArr[ComponentSetInlineCount];
 
-        ComponentSet() = default;
+        ComponentSet()
+            : idArr(nullptr), count(0), hash(0)
+        {
+        }
 
         ~ComponentSet() = default;
 
         ComponentSet(ComponentSet&& other) noexcept
         {
-            idArr = other.idArr;
-            count = other.count;
+            CopyFrom(other);
 
             other.idArr = nullptr;
-            other.count = 0;            
+            other.count = 0;
+            other.hash = 0;
         }
 
         ComponentSet(const ComponentSet& other)
         {
-            idArr = other.idArr;
-            count = other.count;
+            CopyFrom(other);
         }
 
         ComponentSet& operator=(ComponentSet&& other) noexcept
         {
-            idArr = other.idArr;
-            count = other.count;
+            if(this != &other)
+            {
+                CopyFrom(other);
 
-            other.idArr = nullptr;
-            other.count = 0;
+                other.idArr = nullptr;
+                other.count = 0;
+                other.hash = 0;
+            }
 
             return *this;
         }
 
         ComponentSet& operator=(const ComponentSet& other)
         {
-            idArr = other.idArr;
-            count = other.count;
+            if(this != &other)
+            {
+                CopyFrom(other);
+            }
 
             return *this;
         }
 
-        bool operator==(const ComponentSet& other)
+        bool IsInline() const
+        {
+            return idArr == inlineArr;
+        }
+
+        void CopyFrom(const ComponentSet& other)
         {
-            if(count != other.count)
+            count = other.count;
+            hash = other.hash;
+
+            if(other.IsInline())
             {
-                return false;
+                idArr = inlineArr;
+                std::memcpy(inlineArr, other.inlineArr, sizeof(EntityId) * count);
             }
-
-            for(uint32_t i = 0; i < count; i++)
+            else
             {
-                if(idArr[i] != other.idArr[i])
-                {
-                    return false;
-                }
+                idArr = other.idArr;
             }
-
-            return true;
         }
 
-        bool operator!=(const ComponentSet& other)
+        bool operator==(const ComponentSet& other) const
         {
-            if(count == other.count)
+            if(count != other.count || Hash() != other.Hash())
             {
-                return true;
+                return false;
             }
 
             for(uint32_t i = 0; i < count; i++)
             {
                 if(idArr[i] != other.idArr[i])
                 {
-                    return true;
+                    return false;
                 }
             }
 
-            return false;
+            return true;
+        }
+
+        bool operator!=(const ComponentSet& other) const
+        {
+            return !(*this == other);
         }
 
         uint64_t Hash() const
         {
-            uint64_t h = 0;
-            for(uint32_t i = 0; i < count; i++)
+            if(hash == 0)
             {
-                h += HashU64(idArr[i]);
-            }
+                uint64_t h = HashU64(count);
+
+                for(uint32_t i = 0; i < count; i++)
+                {
+                    //mixing the running hash keeps the order in it
+                    h = HashU64(h ^ (idArr[i] + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2)));
+                }
 
-            h /= count;
+                hash = h == 0 ? 1 : h;
+            }
 
-            return h;
+            return hash;
         }
 
         void Sort(){
             std::sort(idArr, (idArr + count));
+            hash = 0;
         }
 
         int32_t Search(EntityId id)
@@ -253,6 +286,19 @@ namespace ECS
             return -1;
         }
 
+        //pairs sort by target first, every pair to a target is in one range
+        int32_t SearchTarget(EntityId target)
+        {
+            EntityId* v = std::lower_bound(idArr, (idArr + count), MakePair(0, target));
+
+            if(v == (idArr + count) || HI_ENTITY_ID(*v) != LO_ENTITY_ID(target))
+            {
+                return -1;
+            }
+
+            return static_cast<int32_t>(v - idArr);
+        }
+
         bool Has(EntityId id)
         {
             EntityId* v = std::lower_bound(idArr, (idArr + count), id);
@@ -286,12 +332,26 @@ namespace ECS
 
         void Alloc(WorldAllocator& wAllocator, uint32_t capacity)
         {
-            idArr = PTR_CAST(wAllocator.Alloc(capacity * sizeof(EntityId)), EntityId);
+            hash = 0;
+
+            if(capacity <= ComponentSetInlineCount)
+            {
+                idArr = inlineArr;
+            }
+            else
+            {
+                idArr = PTR_CAST(wAllocator.Alloc(capacity * sizeof(EntityId)), EntityId);
+            }
         }
 
         void Free(WorldAllocator& wAllocator)
         {
-            wAllocator.Free(sizeof(EntityId) * count, idArr);
+            if(idArr && !IsInline())
+            {
+                wAllocator.Free(sizeof(EntityId) * count, idArr);
+            }
+
+            idArr = nullptr;
         }
     };
 
@@ -309,20 +369,78 @@ namespace ECS
     using MoveCtorHook = void (*)(void* dest, void* src);
     using DtorHook     = void (*)(void* src);
 
-    using AddEventHook = void (*)();
-    using RemoveEventHook = void (*)();
-    using SetEventHook = void (*)(void* dest);
-
     struct TypeHook
     {
         void (*ctor)(void* dest);
         void (*copyCtor)(void* dest, const void* src);
         void (*moveCtor)(void* dest, void* src);
         void (*dtor)(void* src);
+    };
+
+    constexpr uint32_t SignatureWordCount = 4;
+    constexpr uint32_t SignatureBitCount = SignatureWordCount * 64;
+    constexpr uint32_t InvalidDenseIndex = UINT32_MAX;
+
+    /*
+        Fixed-width bitset over component dense indices, pairs use the bit of their relation.
+        A query matches an archetype when its signature is a subset of the archetype signature
+    */
+    struct ComponentSignature
+    {
+        uint64_t words[SignatureWordCount];
+
+        void Clear()
+        {
+            std::memset(words, 0, sizeof(words));
+        }
+
+        void Set(uint32_t bit)
+        {
+            assert(bit < SignatureBitCount);
+            words[bit >> 6] |= 1ULL << (bit & 63);
+        }
 
-        void (*onAdd)();
-        void (*onRemove)();
-        void (*onSet)(void* dest);
+        bool Test(uint32_t bit) const
+        {
+            return (words[bit >> 6] >> (bit & 63)) & 1ULL;
+        }
+
+        bool IsSubsetOf(const ComponentSignature& other) const
+        {
+#if defined(__AVX2__)
+            __m256i sub = _mm256_loadu_si256(PTR_RCAST(words, const __m256i));
+            __m256i super = _mm256_loadu_si256(PTR_RCAST(other.words, const __m256i));
+
+            //(~super & sub) == 0
+            return _mm256_testc_si256(super, sub) != 0;
+#elif defined(__SSE2__) || defined(_M_X64)
+            __m128i zero = _mm_setzero_si128();
+
+            for(uint32_t i = 0; i < SignatureWordCount; i += 2)
+            {
+                __m128i sub = _mm_loadu_si128(PTR_RCAST(&words[i], const __m128i));
+                __m128i super = _mm_loadu_si128(PTR_RCAST(&other.words[i], const __m128i));
+                __m128i missing = _mm_andnot_si128(super, sub);
+
+                if(_mm_movemask_epi8(_mm_cmpeq_epi8(missing, zero)) != 0xFFFF)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+#else
+            for(uint32_t i = 0; i < SignatureWordCount; i++)
+            {
+                if((words[i] & ~other.words[i]) != 0)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+#endif
+        }
     };
 
 #define COMPONENT_TYPE      1 << 0
@@ -332,6 +450,8 @@ namespace ECS
 #define EXCLUSIVE_PAIR      1 << 4
 #define BITSET_DATA         1 << 5
 #define FULL_PAIR           1 << 6
+#define TRIVIALLY_RELOCATABLE 1 << 7 //moved with memcpy, the source is not destroyed
+#define SPARSE_STORAGE      1 << 8 //stored out of archetypes, adding or removing never moves the entity
 
     struct TypeInfo
     {
@@ -340,6 +460,13 @@ namespace ECS
         uint32_t size;
         TypeHook hook;
         uint32_t flags;
+        uint32_t denseIndex = InvalidDenseIndex; //signature bit, full pairs share their relation's
+        const SoaLayout* soa = nullptr; //null for array of structs columns
+
+        bool IsSoa() const
+        {
+            return soa != nullptr;
+        }
 
         bool HasData() const
         {
@@ -360,18 +487,63 @@ namespace ECS
         {
             return (flags & (PAIR_TYPE | FULL_PAIR)) == (PAIR_TYPE | FULL_PAIR);
         }
+
+        bool IsTriviallyRelocatable() const
+        {
+            return (flags & TRIVIALLY_RELOCATABLE) == TRIVIALLY_RELOCATABLE;
+        }
+
+        bool IsSparse() const
+        {
+            return (flags & SPARSE_STORAGE) == SPARSE_STORAGE;
+        }
     };
 
     struct Column
     {
-        void* data;
         TypeInfo* typeInfo;
+        uint32_t offset; //byte offset of the column inside every chunk
+    };
+
+    /*
+        Enable bits of a component toggled through (Toggle, component).
+        One bit per row, 64 rows per word, a cleared bit hides the row from queries
+    */
+    struct ToggleColumn
+    {
+        EntityId id; //toggled component
+        uint32_t offset; //byte offset of the bitset inside every chunk
     };
 
     using ComponentDiff = ComponentSet;
     using ArchetypeId = uint32_t;
 
-    constexpr uint32_t DefaultArchetypeCapacity = 4;
+    /*
+        Archetype rows live in fixed-size chunks, each chunk holds the entity ids
+        and a slice of every column: [entities | column 0 | column 1 | ... | toggles]
+        Growing allocates one more chunk, existing rows never relocate.
+        Ticks hold the world change tick of the last write to every column of the chunk,
+        they are kept out of the chunk so a full layout is not halved for them
+    */
+    constexpr uint32_t ArchetypeChunkSize = KB(16);
+    constexpr uint32_t ArchetypeChunksPerBlock = 16;
+
+    //chunks start on a cache line, columns are aligned to their type at least.
+    //ECS_ALIGN_COLUMNS puts every column on a cache line with at least one SIMD width of rows
+#ifdef ECS_ALIGN_COLUMNS
+    constexpr uint32_t ColumnAlignment = 64;
+    constexpr uint32_t MinChunkRowShift = 3; //at least 8 rows, one AVX register of floats
+#else
+    constexpr uint32_t ColumnAlignment = 1;
+    constexpr uint32_t MinChunkRowShift = 0;
+#endif
+    constexpr uint32_t DefaultArchetypeEdgeCount = 4;
+
+    struct ArchetypeChunk
+    {
+        void* data;
+        uint32_t* ticks; //one per column, null without columns
+    };
 
     struct Archetype
     {
@@ -380,17 +552,28 @@ namespace ECS
         uint32_t capacity;
         uint32_t flags;
         Column* columns;
-        EntityId* entities;
+        Store<ArchetypeChunk> chunks;
+        uint32_t chunkByteSize;
+        uint32_t chunkRowShift; //rows per chunk = 1 << chunkRowShift
         ComponentSet components;
         int32_t* componentMap;
         HashMap<EntityId, Archetype*> addEdges;
         HashMap<EntityId, Archetype*> removeEdges;
         uint32_t columnCount;
+        int32_t* denseColumnMap; //column per dense index, -1 for tags and missing types
+        uint32_t denseColumnCount;
+        ToggleColumn* toggles;
+        uint32_t toggleCount;
+        ComponentSignature signature;
+        uint32_t depth; //ChildOf depth of every row, 0 without parent
 
         Archetype()
             : id(0), count(0), capacity(0), flags(0),
-            columns(nullptr), entities(nullptr), components(), addEdges(), removeEdges()
+            columns(nullptr), chunks(), chunkByteSize(0), chunkRowShift(0),
+            components(), addEdges(), removeEdges(), denseColumnMap(nullptr), denseColumnCount(0),
+            toggles(nullptr), toggleCount(0), depth(0)
         {
+            signature.Clear();
         }
 
         Archetype(Archetype&& other) noexcept
@@ -401,14 +584,25 @@ namespace ECS
             flags = other.flags;
             columnCount = other.columnCount;
             columns = other.columns;
-            entities = other.entities;
+            chunks = other.chunks;
+            chunkByteSize = other.chunkByteSize;
+            chunkRowShift = other.chunkRowShift;
             componentMap = other.componentMap;
+            denseColumnMap = other.denseColumnMap;
+            denseColumnCount = other.denseColumnCount;
+            toggles = other.toggles;
+            toggleCount = other.toggleCount;
+            signature = other.signature;
+            depth = other.depth;
             components = std::move(other.components);
             addEdges = std::move(other.addEdges);
             removeEdges = std::move(other.removeEdges);
 
             other.columns = nullptr;
-            other.entities = nullptr;
+            other.denseColumnMap = nullptr;
+            other.toggles = nullptr;
+            other.chunks.store = nullptr;
+            other.chunks.count = 0;
             other.components.idArr = nullptr;
             other.components.count = 0;
         }
@@ -421,20 +615,145 @@ namespace ECS
             flags = other.flags;
             columnCount = other.columnCount;
             columns = other.columns;
-            entities = other.entities;
+            chunks = other.chunks;
+            chunkByteSize = other.chunkByteSize;
+            chunkRowShift = other.chunkRowShift;
             componentMap = other.componentMap;
+            denseColumnMap = other.denseColumnMap;
+            denseColumnCount = other.denseColumnCount;
+            toggles = other.toggles;
+            toggleCount = other.toggleCount;
+            signature = other.signature;
+            depth = other.depth;
             components = std::move(other.components);
             addEdges = std::move(other.addEdges);
             removeEdges = std::move(other.removeEdges);
 
             other.columns = nullptr;
-            other.entities = nullptr;
+            other.denseColumnMap = nullptr;
+            other.toggles = nullptr;
+            other.chunks.store = nullptr;
+            other.chunks.count = 0;
             other.components.idArr = nullptr;
             other.components.count = 0;
 
             return *this;
         }
 
+        int32_t GetDenseColumn(uint32_t denseIndex) const
+        {
+            return denseIndex < denseColumnCount ? denseColumnMap[denseIndex] : -1;
+        }
+
+        uint32_t GetChunkCapacity() const
+        {
+            return 1u << chunkRowShift;
+        }
+
+        uint32_t GetChunkIndex(uint32_t row) const
+        {
+            return row >> chunkRowShift;
+        }
+
+        uint32_t GetChunkRow(uint32_t row) const
+        {
+            return row & (GetChunkCapacity() - 1);
+        }
+
+        //number of alive rows inside a chunk, every chunk but the last one is full
+        uint32_t GetChunkCount(uint32_t chunkIdx) const
+        {
+            uint32_t first = chunkIdx << chunkRowShift;
+
+            if(first >= count)
+            {
+                return 0;
+            }
+
+            return std::min(count - first, GetChunkCapacity());
+        }
+
+        EntityId* GetChunkEntities(uint32_t chunkIdx)
+        {
+            return PTR_CAST(chunks.store[chunkIdx].data, EntityId);
+        }
+
+        void* GetChunkColumn(uint32_t chunkIdx, uint32_t colIdx)
+        {
+            return OFFSET(chunks.store[chunkIdx].data, columns[colIdx].offset);
+        }
+
+        EntityId& GetEntity(uint32_t row)
+        {
+            return GetChunkEntities(GetChunkIndex(row))[GetChunkRow(row)];
+        }
+
+        //first byte of a field of a structure of arrays column
+        void* GetFieldData(uint32_t colIdx, uint32_t field, uint32_t row)
+        {
+            const SoaLayout& soa = *columns[colIdx].typeInfo->soa;
+            void* column = GetChunkColumn(GetChunkIndex(row), colIdx);
+
+            return OFFSET(column, soa.offsets[field] * GetChunkCapacity() + soa.sizes[field] * GetChunkRow(row));
+        }
+
+        //array of structs columns only
+        void* GetColumnData(uint32_t colIdx, uint32_t row)
+        {
+            Column& col = columns[colIdx];
+
+            return OFFSET_ELEMENT(GetChunkColumn(GetChunkIndex(row), colIdx),
+                                  col.typeInfo->size, GetChunkRow(row));
+        }
+
+        //change tick of every column in the chunk
+        uint32_t* GetChunkTicks(uint32_t chunkIdx)
+        {
+            return chunks.store[chunkIdx].ticks;
+        }
+
+        //-1 when the component is not toggleable in this archetype
+        int32_t GetToggleIndex(EntityId cId) const
+        {
+            for(uint32_t idx = 0; idx < toggleCount; idx++)
+            {
+                if(toggles[idx].id == cId)
+                {
+                    return CAST(idx, int32_t);
+                }
+            }
+
+            return -1;
+        }
+
+        uint64_t* GetChunkToggle(uint32_t chunkIdx, uint32_t toggleIdx)
+        {
+            return PTR_CAST(OFFSET(chunks.store[chunkIdx].data, toggles[toggleIdx].offset), uint64_t);
+        }
+
+        bool IsEnabled(uint32_t toggleIdx, uint32_t row)
+        {
+            uint32_t chunkRow = GetChunkRow(row);
+            uint64_t* words = GetChunkToggle(GetChunkIndex(row), toggleIdx);
+
+            return (words[chunkRow >> 6] >> (chunkRow & 63)) & 1ULL;
+        }
+
+        void SetEnabled(uint32_t toggleIdx, uint32_t row, bool isEnabled)
+        {
+            uint32_t chunkRow = GetChunkRow(row);
+            uint64_t* words = GetChunkToggle(GetChunkIndex(row), toggleIdx);
+            uint64_t bit = 1ULL << (chunkRow & 63);
+
+            if(isEnabled)
+            {
+                words[chunkRow >> 6] |= bit;
+            }
+            else
+            {
+                words[chunkRow >> 6] &= ~bit;
+            }
+        }
     };
 
     inline ArchetypeId GetArchetypeId()
@@ -455,6 +774,43 @@ namespace ECS
 
     };
 
+    /*
+        Storage of a sparse component, outside of every archetype.
+        Data is packed by slot and the index maps an entity to its slot,
+        removing fills the hole from the last slot.
+        Data grows in place inside its arena, so slot addresses stay valid
+    */
+    struct SparseStorage
+    {
+        TypeInfo* typeInfo;
+        SparseSet<uint32_t> index;
+        Store<EntityId> entities; //entity of every slot
+        ColumnArena arena;
+        void* data; //null for tags
+        uint32_t capacity;
+
+        uint32_t GetCount() const
+        {
+            return entities.count;
+        }
+
+        void* GetData(uint32_t slot)
+        {
+            return OFFSET_ELEMENT(data, typeInfo->size, slot);
+        }
+
+        //read only, safe while systems run in parallel
+        uint32_t* TryGetSlot(EntityId eId)
+        {
+            return index.TryGetPageData(eId);
+        }
+
+        bool Has(EntityId eId)
+        {
+            return TryGetSlot(eId) != nullptr;
+        }
+    };
+
     struct EntityRecord
     {
         Archetype* archetype;
@@ -35,6 +35,19 @@ namespace ECS
         return (n + mask) & ~mask;
     }
     
+    //v must not be 0
+    inline uint32_t CountTrailingZeros64(uint64_t v)
+    {
+#if defined(_MSC_VER)
+        unsigned long idx;
+        _BitScanForward64(&idx, v);
+
+        return CAST(idx, uint32_t);
+#else
+        return CAST(__builtin_ctzll(v), uint32_t);
+#endif
+    }
+
     inline uint32_t RoundMinPowerOf2(uint32_t n, uint32_t min)
     {
         assert((min & (min - 1)) == 0 && "Min alignment must be power of 2!");
@@ -54,4 +67,23 @@ namespace ECS
 
         return n + 1;
     }
+
+    //size must be a multiple of alignment
+    inline void* AlignedAlloc(size_t size, size_t alignment)
+    {
+#if defined(_MSC_VER)
+        return _aligned_malloc(size, alignment);
+#else
+        return std::aligned_alloc(alignment, size);
+#endif
+    }
+
+    inline void AlignedFree(void* addr)
+    {
+#if defined(_MSC_VER)
+        _aligned_free(addr);
+#else
+        std::free(addr);
+#endif
+    }
 }
\ No newline at end of file
@@ -38,6 +38,8 @@ namespace ECS
         void AddTagImpl(EntityId cId) override;
         void AddPairImpl(EntityId first, EntityId second) override;
         void RemoveComponentImpl(EntityId cId) override;
+        void AddToggleImpl(EntityId cId) override;
+        void SetEnabledImpl(EntityId cId, bool isEnabled) override;
         void* GetImpl(EntityId cId) override;
         void SetImpl(EntityId cId, void* data) override;
 
@@ -29,6 +29,15 @@ namespace ECS
         template<typename Component>
         EntityCommandBase& RemoveComponent();
 
+        template<typename Component>
+        EntityCommandBase& AddToggle();
+
+        template<typename Component>
+        EntityCommandBase& Enable();
+
+        template<typename Component>
+        EntityCommandBase& Disable();
+
         /*template<typename FirstComponent, typename... Components>
         EntityMutator& AddComponents(const FirstComponent& f, const Components&... c);
 
@@ -46,6 +55,8 @@ namespace ECS
         virtual void AddTagImpl(EntityId id) = 0;
         virtual void AddPairImpl(EntityId first, EntityId second) = 0;
         virtual void RemoveComponentImpl(EntityId id) = 0;
+        virtual void AddToggleImpl(EntityId id) = 0;
+        virtual void SetEnabledImpl(EntityId id, bool isEnabled) = 0;
         virtual void* GetImpl(EntityId id) = 0;
         virtual void SetImpl(EntityId id, void* data) = 0;
     };
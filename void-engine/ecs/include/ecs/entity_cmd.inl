@@ -37,6 +37,30 @@ namespace ECS
         return *this;   
     }
 
+    template<typename Component>
+    EntityCommandBase& EntityCommandBase::AddToggle()
+    {
+        AddToggleImpl(ComponentTypeId<Component>::id);
+
+        return *this;
+    }
+
+    template<typename Component>
+    EntityCommandBase& EntityCommandBase::Enable()
+    {
+        SetEnabledImpl(ComponentTypeId<Component>::id, true);
+
+        return *this;
+    }
+
+    template<typename Component>
+    EntityCommandBase& EntityCommandBase::Disable()
+    {
+        SetEnabledImpl(ComponentTypeId<Component>::id, false);
+
+        return *this;
+    }
+
     template<typename Component>
     EntityCommandBase& EntityCommandBase::Set(Component&& c)
     {
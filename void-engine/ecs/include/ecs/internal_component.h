@@ -15,6 +15,18 @@ namespace ECS
     constexpr EntityId EcsComponentId = 8; 
     constexpr EntityId EcsQueryId = 9; 
     constexpr EntityId ToggleId = 10;
+    constexpr EntityId WildcardId = 11;
+
+    //(relation, *) matches a pair to any target, (*, target) a pair of any relation
+    inline EntityId AnyTarget(EntityId relation)
+    {
+        return MakePair(relation, WildcardId);
+    }
+
+    inline EntityId AnyRelation(EntityId target)
+    {
+        return MakePair(WildcardId, target);
+    }
 
 
     //internal components
@@ -61,6 +73,11 @@ namespace ECS
     };
     ECS_COMPONENT(EcsQuery);
 
+    struct Wildcard
+    {
+    };
+    ECS_COMPONENT(Wildcard);
+
     //internal pair
     struct ChildOf
     {
@@ -0,0 +1,90 @@
+#pragma once
+#include "ecs_pch.h"
+
+/*
+    Work stealing job scheduler
+    Every thread owns a deque, the owner pushes and pops at the back,
+    idle threads steal from the front of other deques.
+    Thread index 0 is the thread that owns the world
+*/
+
+namespace ECS
+{
+    constexpr uint32_t JobDequeCapacity = 4096;
+
+    using JobFunc = void (*)(void* data);
+
+    struct Job
+    {
+        JobFunc func;
+        void* data;
+        std::atomic<uint32_t>* counter;
+    };
+
+    class JobDeque
+    {
+    public:
+        JobDeque()
+            : m_jobs(nullptr), m_head(0), m_tail(0)
+        {
+        }
+
+        void Init();
+        void Destroy();
+
+        bool Push(const Job& job);
+        bool Pop(Job& job);
+        bool Steal(Job& job);
+
+    private:
+        Job* m_jobs;
+        uint32_t m_head;
+        uint32_t m_tail;
+        std::mutex m_mutex;
+    };
+
+    class JobSystem
+    {
+    public:
+        JobSystem()
+            : m_deques(nullptr), m_workers(nullptr), m_workerCount(0),
+            m_pendingJobs(0), m_running(false)
+        {
+        }
+
+        //workerCount does not include the owner thread
+        void Init(uint32_t workerCount);
+        void Destroy();
+
+        void Schedule(const Job* jobs, uint32_t count);
+
+        //owner thread keeps running jobs until the counter reaches 0
+        void Wait(std::atomic<uint32_t>& counter);
+
+        uint32_t GetWorkerCount() const
+        {
+            return m_workerCount;
+        }
+
+        uint32_t GetThreadCount() const
+        {
+            return m_workerCount + 1;
+        }
+
+        static uint32_t GetThreadIndex();
+
+    private:
+        void WorkerLoop(uint32_t threadIndex);
+        bool TryRunJob(uint32_t threadIndex);
+        void RunJob(const Job& job);
+
+    private:
+        JobDeque* m_deques;
+        std::thread* m_workers;
+        uint32_t m_workerCount;
+        std::atomic<uint32_t> m_pendingJobs;
+        std::atomic<bool> m_running;
+        std::mutex m_sleepMutex;
+        std::condition_variable m_wake;
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "ecs_type.h"
+#include "query.h"
+
+/*
+    Observers are called with every entity an event hit since the last flush.
+    Each observed (event, component) owns one buffer, structural changes only append
+    entity ids to it, so nothing runs on the hot path when no observer is registered.
+    Query observers own a buffer of their own, an entity is appended when the event is emitted
+    and the archetype it enters (OnAdd, OnSet) or leaves (OnRemove) matches the query
+*/
+
+namespace ECS
+{
+    class World;
+
+    enum class EventType : uint32_t
+    {
+        OnAdd,
+        OnRemove,
+        OnSet
+    };
+
+    constexpr uint32_t EventTypeCount = 3;
+
+    using ObserverCallback = void (*)(World* world, EntityId cId, const EntityId* entities, uint32_t count, void* ctx);
+
+    struct Observer
+    {
+        ObserverCallback callback;
+        Query* query; //null observes every entity
+        void* ctx;
+    };
+
+    struct EventBuffer
+    {
+        EntityId component;
+        EventType type;
+        Store<EntityId> entities; //emit order, duplicates are kept
+        Store<Observer> observers;
+        Store<uint32_t> queryBuffers; //query observers with a term on the component
+    };
+
+    struct QueryEventBuffer
+    {
+        Observer observer;
+        Store<EntityId> entities; //sorted and deduplicated before the call
+    };
+}
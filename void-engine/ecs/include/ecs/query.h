@@ -4,24 +4,6 @@
 
 namespace ECS
 {
-    struct ArchetypeLinkedList
-    {
-        Archetype* archetype;
-        ArchetypeLinkedList* next;
-
-        static ArchetypeLinkedList* Alloc(WorldAllocator& wAllocator)
-        {
-            ArchetypeLinkedList* all = PTR_CAST(wAllocator.Calloc(sizeof(ArchetypeLinkedList)), ArchetypeLinkedList);
-        
-            return all;
-        }
-
-        static void Free(WorldAllocator& wAllocator, void* addr)
-        {
-            wAllocator.Free(sizeof(ArchetypeLinkedList), addr); 
-        }
-    };
-
     class World;
 
     struct QueryIterator
@@ -33,28 +15,144 @@ namespace ECS
 
         Entity GetEntity()
         {
-            EntityId id = archetype->entities[row];
+            EntityId id = archetype->GetEntity(row);
 
             return Entity(id, world);
         }
 
         template<typename Component>
-        Component& Get()
+        Component& Get();
+    };
+
+    constexpr uint32_t MaxQueryTermCount = 16;
+
+    /*
+        Query keeps its matched archetypes in a contiguous store.
+        The world registers every query and matches new archetypes once, on creation.
+        Term columns are resolved at match time, terms.count entries per matched archetype.
+        Sparse terms are not part of the match, rows are joined with their storage while iterating.
+        (relation, *) terms match through the relation's signature bit, (*, target) terms
+        through a binary search of the target's pair range, exact (relation, target) terms
+        through the relation's bit then a search of the pair itself.
+        Toggled terms keep the index of their enable bits in the archetype, -1 when always enabled.
+        Cascade order holds the match indices sorted by ChildOf depth, parents before children,
+        it is sorted again when a match is added or the world hierarchy changes
+    */
+    struct Query
+    {
+        ComponentSet terms;
+        Store<Archetype*> archetypes;
+        Store<int32_t> columns;
+        Store<int32_t> toggles;
+        ComponentSignature signature;
+        bool hasSignature;
+        SparseStorage* sparseTerms[MaxQueryTermCount]; //null for archetype terms
+        uint32_t sparseTermCount;
+        EntityId targetTerms[MaxQueryTermCount]; //target of (*, target) terms, 0 for the others
+        uint32_t targetTermCount;
+        EntityId pairTerms[MaxQueryTermCount]; //exact (relation, target) terms, 0 for the others
+        uint32_t pairTermCount;
+        Store<uint32_t> cascadeOrder;
+        uint32_t cascadeVersion; //hierarchy version the order was sorted for
+
+        bool Match(Archetype* archetype)
         {
-            uint32_t colIdx = archetype->components.Search(ComponentTypeId<EntityId>::id);
+            for(uint32_t idx = 0; idx < terms.count && targetTermCount; idx++)
+            {
+                if(targetTerms[idx] && archetype->components.SearchTarget(targetTerms[idx]) == -1)
+                {
+                    return false;
+                }
+            }
+
+            //the signature only holds the relation's bit
+            for(uint32_t idx = 0; idx < terms.count && pairTermCount; idx++)
+            {
+                if(pairTerms[idx] && !archetype->components.Has(pairTerms[idx]))
+                {
+                    return false;
+                }
+            }
+
+            if(hasSignature)
+            {
+                return signature.IsSubsetOf(archetype->signature);
+            }
 
-            assert(colIdx != -1);
+            for(uint32_t idx = 0; idx < terms.count; idx++)
+            {
+                if(sparseTerms[idx] || targetTerms[idx] || pairTerms[idx])
+                {
+                    continue;
+                }
 
-            Column& col = archetype->columns[colIdx];
-            TypeInfo& ti = *col.typeInfo;
-            void* comData = OFFSET(col.data, ti.size * row);
-            
-            return *PTR_CAST(comData, Component);
+                //Archetype does not contain the same set of components
+                if(!archetype->components.Has(terms.idArr[idx]) &&
+                   !archetype->components.HasPair(terms.idArr[idx]))
+                {
+                    return false;
+                }
+            }
+
+            return true;
         }
-    };
 
-    struct Query
-    {
-        ArchetypeLinkedList* head;
+        int32_t* GetColumns(uint32_t matchIdx)
+        {
+            return columns.store + matchIdx * terms.count;
+        }
+
+        int32_t* GetToggles(uint32_t matchIdx)
+        {
+            return toggles.store + matchIdx * terms.count;
+        }
+
+        void AddArchetype(WorldAllocator& wAllocator, Archetype* archetype)
+        {
+            if(archetypes.count == archetypes.capacity)
+            {
+                archetypes.Grow(wAllocator);
+            }
+
+            archetypes.Add(archetype);
+
+            for(uint32_t idx = 0; idx < terms.count; idx++)
+            {
+                if(columns.count == columns.capacity)
+                {
+                    columns.Grow(wAllocator);
+                }
+
+                if(toggles.count == toggles.capacity)
+                {
+                    toggles.Grow(wAllocator);
+                }
+
+                if(sparseTerms[idx])
+                {
+                    columns.Add(-1);
+                    toggles.Add(-1);
+                    continue;
+                }
+
+                toggles.Add(archetype->GetToggleIndex(terms.idArr[idx]));
+
+                //the first pair of a wildcard term gives its column
+                int32_t cIdx = targetTerms[idx] ?
+                    archetype->components.SearchTarget(targetTerms[idx]) :
+                    archetype->components.Search(terms.idArr[idx]);
+
+                //a relation term takes the column of any of its pairs, an exact pair only its own
+                if(cIdx == -1 && !pairTerms[idx])
+                {
+                    cIdx = archetype->components.SearchPair(terms.idArr[idx]);
+                }
+
+                assert(cIdx != -1);
+
+                //-1 for no data tag and pair
+                columns.Add(archetype->componentMap[cIdx]);
+            }
+        }
     };
 }
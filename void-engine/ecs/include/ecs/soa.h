@@ -0,0 +1,91 @@
+#pragma once
+#include "ecs_pch.h"
+
+/*
+    Structure of arrays layout, opted in per component with ECS_SOA next to ECS_COMPONENT:
+
+        ECS_COMPONENT(Position)
+        ECS_SOA(Position, x, y, z)
+
+    The column keeps its size of size * rows, field f streams from offsetof(f) * rows,
+    so every stream is contiguous inside the chunk and aligned to its field.
+    Systems see the whole chunk through Soa<T> views, Soa<const T> for read only access.
+    SoA components must be trivially copyable and destructible, rows are moved field by field
+*/
+
+namespace ECS
+{
+    struct SoaLayout
+    {
+        uint32_t fieldCount;
+        const uint32_t* offsets;
+        const uint32_t* sizes;
+    };
+
+    //specialized by ECS_SOA, count is 0 for array of structs components
+    template<typename T>
+    struct SoaFields
+    {
+        static constexpr uint32_t count = 0;
+    };
+
+    //typed field pointers to the first row of a chunk, count rows per field
+    template<typename T>
+    struct Soa;
+
+    template<typename T>
+    constexpr bool is_soa_component_v = SoaFields<std::remove_const_t<T>>::count > 0;
+}
+
+#define ECS_SOA_EXPAND(x) x
+
+#define ECS_SOA_FOR_EACH_1(M, T, a) M(T, a)
+#define ECS_SOA_FOR_EACH_2(M, T, a, ...) M(T, a) ECS_SOA_EXPAND(ECS_SOA_FOR_EACH_1(M, T, __VA_ARGS__))
+#define ECS_SOA_FOR_EACH_3(M, T, a, ...) M(T, a) ECS_SOA_EXPAND(ECS_SOA_FOR_EACH_2(M, T, __VA_ARGS__))
+#define ECS_SOA_FOR_EACH_4(M, T, a, ...) M(T, a) ECS_SOA_EXPAND(ECS_SOA_FOR_EACH_3(M, T, __VA_ARGS__))
+#define ECS_SOA_FOR_EACH_5(M, T, a, ...) M(T, a) ECS_SOA_EXPAND(ECS_SOA_FOR_EACH_4(M, T, __VA_ARGS__))
+#define ECS_SOA_FOR_EACH_6(M, T, a, ...) M(T, a) ECS_SOA_EXPAND(ECS_SOA_FOR_EACH_5(M, T, __VA_ARGS__))
+#define ECS_SOA_FOR_EACH_7(M, T, a, ...) M(T, a) ECS_SOA_EXPAND(ECS_SOA_FOR_EACH_6(M, T, __VA_ARGS__))
+#define ECS_SOA_FOR_EACH_8(M, T, a, ...) M(T, a) ECS_SOA_EXPAND(ECS_SOA_FOR_EACH_7(M, T, __VA_ARGS__))
+
+#define ECS_SOA_GET_FOR_EACH(_1, _2, _3, _4, _5, _6, _7, _8, NAME, ...) NAME
+#define ECS_SOA_FOR_EACH(M, T, ...) \
+        ECS_SOA_EXPAND(ECS_SOA_GET_FOR_EACH(__VA_ARGS__, \
+            ECS_SOA_FOR_EACH_8, ECS_SOA_FOR_EACH_7, ECS_SOA_FOR_EACH_6, ECS_SOA_FOR_EACH_5, \
+            ECS_SOA_FOR_EACH_4, ECS_SOA_FOR_EACH_3, ECS_SOA_FOR_EACH_2, ECS_SOA_FOR_EACH_1)(M, T, __VA_ARGS__))
+
+#define ECS_SOA_OFFSET(T, f) CAST(offsetof(T, f), uint32_t),
+#define ECS_SOA_SIZE(T, f) CAST(sizeof(decltype(T::f)), uint32_t),
+#define ECS_SOA_MEMBER(T, f) decltype(T::f)* f;
+#define ECS_SOA_CONST_MEMBER(T, f) const decltype(T::f)* f;
+#define ECS_SOA_INIT(T, f) f(PTR_CAST(OFFSET(column, offsetof(T, f) * rows), decltype(T::f))),
+#define ECS_SOA_CONST_INIT(T, f) f(PTR_CAST(OFFSET(column, offsetof(T, f) * rows), const decltype(T::f))),
+
+#define ECS_SOA(T, ...) \
+        namespace ECS \
+        { \
+            template<> \
+            struct SoaFields<T> \
+            { \
+                static constexpr uint32_t offsets[] = {ECS_SOA_FOR_EACH(ECS_SOA_OFFSET, T, __VA_ARGS__)}; \
+                static constexpr uint32_t sizes[] = {ECS_SOA_FOR_EACH(ECS_SOA_SIZE, T, __VA_ARGS__)}; \
+                static constexpr uint32_t count = sizeof(offsets) / sizeof(uint32_t); \
+                static constexpr SoaLayout layout = {count, offsets, sizes}; \
+            }; \
+            template<> \
+            struct Soa<T> \
+            { \
+                ECS_SOA_FOR_EACH(ECS_SOA_MEMBER, T, __VA_ARGS__) \
+                uint32_t count; \
+                Soa(void* column, uint32_t rows, uint32_t rowCount) \
+                    : ECS_SOA_FOR_EACH(ECS_SOA_INIT, T, __VA_ARGS__) count(rowCount) {} \
+            }; \
+            template<> \
+            struct Soa<const T> \
+            { \
+                ECS_SOA_FOR_EACH(ECS_SOA_CONST_MEMBER, T, __VA_ARGS__) \
+                uint32_t count; \
+                Soa(void* column, uint32_t rows, uint32_t rowCount) \
+                    : ECS_SOA_FOR_EACH(ECS_SOA_CONST_INIT, T, __VA_ARGS__) count(rowCount) {} \
+            }; \
+        }
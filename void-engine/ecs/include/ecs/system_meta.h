@@ -44,12 +44,44 @@ namespace ECS
     template<typename T, typename... Components>
     constexpr uint32_t index_of_v = index_of<T, Components...>::value;
 
+    template<typename T>
+    struct soa_traits
+    {
+        using type = T;
+        static constexpr bool value = false;
+        static constexpr bool isConst = false;
+    };
+
+    template<typename T>
+    struct soa_traits<Soa<T>>
+    {
+        using type = std::remove_const_t<T>;
+        static constexpr bool value = true;
+        static constexpr bool isConst = std::is_const_v<T>;
+    };
+
+    template<typename T>
+    constexpr bool is_soa_view_v = soa_traits<decay_t<T>>::value;
+
+    //query term of an argument, the component of a Soa<T> view
+    template<typename T>
+    using term_t = typename soa_traits<decay_t<T>>::type;
+
+#define SYSTEM_PARALLEL     1 << 0
+#define SYSTEM_CHANGED      1 << 1 //skips chunks where no const term changed since the last run
+#define SYSTEM_CASCADE      1 << 2 //runs parents before children, serially
+
     struct SystemCallback
     {
         void* funcPtr;
         void (*invoker)(void*, QueryIterator*, void**);
-        ArchetypeLinkedList* archetypeList;
-        ComponentSet components;
+        Query* query;
+        EntityId entity;
+        uint32_t flags;
+        uint32_t readMask;  //bit per query term, const T& arguments
+        uint32_t writeMask; //bit per query term, T& arguments
+        uint32_t lastRunTick; //change tick of the stage that last ran the system
+        bool isChunk; //takes Soa<T> views, runs once per chunk instead of once per row
 
         void Execute(QueryIterator* it, void** componentsData)
         {
@@ -71,11 +103,23 @@ namespace ECS
                 return *it;
             }
         }
+        else if constexpr(is_soa_view_v<FuncArgs>)
+        {
+            constexpr uint32_t idx = index_of_v<term_t<FuncArgs>, Components...>;
+            Archetype* archetype = it->archetype;
+
+            assert(componentsData[idx] && "Component has no data!");
+
+            return decay_t<FuncArgs>(componentsData[idx], archetype->GetChunkCapacity(),
+                                     archetype->GetChunkCount(archetype->GetChunkIndex(it->row)));
+        }
         else
         {
             constexpr uint32_t idx = index_of_v<FuncArgs, Components...>;
             using ComponentType = decay_t<FuncArgs>;
 
+            static_assert(!is_soa_component_v<ComponentType>, "SoA components are accessed through Soa<T> views!");
+
             if constexpr (std::is_const_v<std::remove_reference_t<FuncArgs>>)
             {
                 void* data = componentsData[idx];
@@ -101,20 +145,53 @@ namespace ECS
         }
     }
 
+    template<typename FuncArgs, typename... Components>
+    constexpr uint32_t GetArgAccessMask(bool write)
+    {
+        if constexpr(is_iterator_v<decay_t<FuncArgs>>)
+        {
+            return 0;
+        }
+        else if constexpr(is_soa_view_v<FuncArgs>)
+        {
+            constexpr bool isConst = soa_traits<decay_t<FuncArgs>>::isConst;
+
+            return (isConst != write) ? (1u << index_of_v<term_t<FuncArgs>, Components...>) : 0;
+        }
+        else
+        {
+            constexpr bool isConst = std::is_const_v<std::remove_reference_t<FuncArgs>>;
+
+            return (isConst != write) ? (1u << index_of_v<FuncArgs, Components...>) : 0;
+        }
+    }
+
     template<typename... Components, typename... FuncArgs>
     SystemCallback CreateSystemCallback(void (*func)(FuncArgs...))
     {
         static_assert((... && 
                       (is_iterator_v<FuncArgs> || 
-                      (is_in_component_list<FuncArgs, Components...>::value) &&
-                      std::is_reference_v<FuncArgs>
+                      (is_in_component_list<term_t<FuncArgs>, Components...>::value &&
+                       (std::is_reference_v<FuncArgs> || is_soa_view_v<FuncArgs>))
                       )), "Invalid system parameters!");
 
+        constexpr bool isChunk = (false || ... || is_soa_view_v<FuncArgs>);
+
+        //a chunk system has no current row to hand out a single component for
+        static_assert(!isChunk || (... && (is_iterator_v<decay_t<FuncArgs>> || is_soa_view_v<FuncArgs>)),
+                      "SoA systems take every component as a Soa<T> view!");
+
         SystemCallback cb;
-        cb.funcPtr = CAST(func, void*);
+        cb.isChunk = isChunk;
+        cb.flags = 0;
+        cb.entity = 0;
+        cb.lastRunTick = 0;
+        cb.readMask = (0u | ... | GetArgAccessMask<FuncArgs, Components...>(false));
+        cb.writeMask = (0u | ... | GetArgAccessMask<FuncArgs, Components...>(true));
+        cb.funcPtr = RCAST(func, void*);
         cb.invoker = [](void* fn, QueryIterator* it, void** componentsData)
             {
-                auto actualFunc = CAST(fn, void (*)(FuncArgs...));
+                auto actualFunc = RCAST(fn, void (*)(FuncArgs...));
                 actualFunc(GetArgs<FuncArgs, Components...>(it, componentsData)...);
             };
 
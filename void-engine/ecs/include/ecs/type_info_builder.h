@@ -19,13 +19,13 @@ namespace ECS
 
         TypeInfoBuilder<T>& Dtor(DtorHook dtor);
 
-        TypeInfoBuilder<T>& AddEvent(AddEventHook e);
-
-        TypeInfoBuilder<T>& RemoveEvent(RemoveEventHook e);
+        TypeInfoBuilder<T>& Id(EntityId id);
 
-        TypeInfoBuilder<T>& SetEvent(SetEventHook e);
+        //override the inferred flag, a relocatable type is moved by memcpy without hooks
+        TypeInfoBuilder<T>& TriviallyRelocatable(bool isRelocatable);
 
-        TypeInfoBuilder<T>& Id(EntityId id);
+        //store in a sparse set instead of archetype columns, for components added and removed often
+        TypeInfoBuilder<T>& Sparse();
 
         void Register(const char* name = nullptr);
     };
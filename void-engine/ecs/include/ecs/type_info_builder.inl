@@ -33,38 +33,38 @@ namespace ECS
     }
 
     template<typename T>
-    TypeInfoBuilder<T>& TypeInfoBuilder<T>::AddEvent(AddEventHook e)
+    TypeInfoBuilder<T>& TypeInfoBuilder<T>::Id(EntityId id)
     {
-        ti.hook.onAdd = e;
+        ti.id = id;
 
         return *this;
     }
 
-    template<typename T>
-    TypeInfoBuilder<T>& TypeInfoBuilder<T>::RemoveEvent(RemoveEventHook e)
-    {
-        ti.hook.onRemove = e;
-
-        return *this;
-    }
 
     template<typename T>
-    TypeInfoBuilder<T>& TypeInfoBuilder<T>::SetEvent(SetEventHook e)
+    TypeInfoBuilder<T>& TypeInfoBuilder<T>::TriviallyRelocatable(bool isRelocatable)
     {
-        ti.hook.onSet = e;
+        if(isRelocatable)
+        {
+            ti.flags |= TRIVIALLY_RELOCATABLE;
+        }
+        else
+        {
+            ti.flags &= ~(TRIVIALLY_RELOCATABLE);
+        }
 
         return *this;
     }
 
     template<typename T>
-    TypeInfoBuilder<T>& TypeInfoBuilder<T>::Id(EntityId id)
+    TypeInfoBuilder<T>& TypeInfoBuilder<T>::Sparse()
     {
-        ti.id = id;
+        assert(!ti.IsSoa() && "SoA components can not use sparse storage!");
+        ti.flags |= SPARSE_STORAGE;
 
         return *this;
     }
 
-
     template<typename T>
     void TypeInfoBuilder<T>::Register(const char* name)
     {
@@ -75,9 +75,10 @@ namespace ECS
 
         if(!ti.IsFullPair())
         {
+            //a fresh id, reused ones carry a generation in the bits pairs use
             if(ti.id == 0 || world->m_entityIndex.isValidDense(ti.id))
             {
-                Entity e = world->CreateEntity(name, 0);
+                Entity e = world->CreateEntity(world->GetNextFreeId(), name, 0);
                 ti.id = e.GetFullId();
             }
             else
@@ -91,13 +92,19 @@ namespace ECS
                     Entity e = world->CreateEntity(ti.id, 0);
                 }
             }
+
+            //past the signature width queries on this type fall back to the term loop
+            if(!ti.IsSparse() && world->m_denseIndexCount < SignatureBitCount)
+            {
+                ti.denseIndex = world->m_denseIndexCount++;
+                world->m_denseIndices.PushBack(ti.id, ti.denseIndex);
+            }
         }
 
-        if(world->m_componentStore.capacity == world->m_componentStore.count)
+        if(!ti.IsFullPair())
         {
-            world->m_componentStore.Grow(world->m_wAllocator);
+            ComponentTypeId<T>::Id(ti.id);
         }
-        world->m_componentStore.Add(ti.id);
 
         ComponentRecord cr;
         cr.id = ti.id;
@@ -116,7 +123,6 @@ namespace ECS
         else
         {
             std::snprintf(cr.name, 16, name);
-            ComponentTypeId<T>::Id(ti.id);
         }
 #endif
 
@@ -127,6 +133,12 @@ namespace ECS
         world->m_componentIndex.Insert(ti.id, std::move(cr));
         world->m_typeInfos.Insert(ti.id, &ti);
 
+        if(ti.IsSparse())
+        {
+            assert(!(ti.flags & PAIR_TYPE) && "Pairs can not use sparse storage!");
+            world->CreateSparseStorage(ti);
+        }
+
         if constexpr(std::is_same_v<EcsName, T>)
         {
             world->AddComponent(ti.id, EcsNameId);
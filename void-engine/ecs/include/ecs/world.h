@@ -8,6 +8,9 @@
 #include "system_meta.h"
 #include "internal_component.h"
 #include "entity_cmd.h"
+#include "job_system.h"
+#include "command_buffer.h"
+#include "observer.h"
 
 namespace ECS
 {
@@ -15,13 +18,15 @@ namespace ECS
     {
         //BlockAllocator typeInfo;
         BlockAllocator archetypes;
+        BlockAllocator chunks;
     };
 
     class World
     {
     public:
         World()
-            : m_nextFreeId(200), m_isDefered(false)
+            : m_commandBuffers(nullptr), m_commandBufferCount(0), m_deferredNextId(0),
+            m_nextFreeId(200), m_denseIndexCount(0), m_changeTick(1), m_hierarchyVersion(1), m_isFlushing(false), m_isDefered(false), m_isScheduleDirty(false)
         {
         }
 
@@ -29,6 +34,9 @@ namespace ECS
 
         void InitAllocators();
 
+        //0 keeps every system on the calling thread
+        void SetWorkerCount(uint32_t count);
+
         void RegisterInternalComponents();
 
         Entity CreateEntity();
@@ -39,13 +47,47 @@ namespace ECS
 
         Entity CreateEntity(EntityDesc& desc);
 
+        //ids are contiguous, the first one is returned
+        //values follow the component set order, a null value default constructs
+        EntityId CreateEntities(uint32_t count, const ComponentSet& componentSet, const void* const* values = nullptr);
+
+        template<typename... Components>
+        EntityId CreateEntities(uint32_t count);
+
+        template<typename... Components>
+        EntityId CreateEntities(uint32_t count, const Components&... values);
+
+        //reserves an id without touching the entity index, the record is created on merge
+        EntityId DeferCreateEntity(EntityId id, const char* name, EntityId parent);
+
+        //ids never used, above every explicit id, O(1)
         EntityId GetNextFreeId();
+        EntityId GetFreeIdRange(uint32_t count);
         EntityId GetReusedId();
         std::pair<bool, EntityId> GetId();
 
         EntityRecord* GetEntityRecord(EntityId eId);
         Entity GetEntity(EntityId eId);
 
+        //false for a stale generation of a reused id
+        bool IsAlive(EntityId eId);
+
+        void DestroyEntity(EntityId eId);
+
+        //rows are removed table by table, the ids are freed for reuse and every pair to them is dropped
+        //ChildOf children are destroyed too, or moved to the first parent that survives on reparent
+        void DestroyEntities(const EntityId* ids, uint32_t count, bool isReparent = false);
+
+        void ReparentChildren(EntityId parent);
+
+        //removes the pairs to a destroyed entity from the survivors, then deletes their archetypes
+        void DropTarget(EntityId target);
+
+        //unlinks an empty archetype from edges, records and queries before freeing it
+        void DeleteArchetype(Archetype* archetype);
+
+        void FreeArchetype(Archetype& archetype);
+
         void ResolveEntityDesc(EntityRecord& r, EntityDesc& desc);
 
         template<typename T>
@@ -71,12 +113,35 @@ namespace ECS
 
         void AddComponent(EntityId eId, EntityId cId);
 
+        EntityId RegisterPair(EntityId first, EntityId second);
+
         void AddPair(EntityId eId, EntityId first, EntityId second);
 
         void AddTag(EntityId eId, EntityId cId);
 
         void RemoveComponent(EntityId eId, EntityId cId);
 
+        //adds (Toggle, component), the component can then be enabled without moving the entity
+        void AddToggle(EntityId eId, EntityId cId);
+
+        //the component must be toggleable on the entity
+        void SetEnabled(EntityId eId, EntityId cId, bool isEnabled);
+
+        //components without toggle are always enabled
+        bool IsEnabled(EntityId eId, EntityId cId);
+
+        template<typename T>
+        void AddToggle(EntityId eId);
+
+        template<typename T>
+        void Enable(EntityId eId);
+
+        template<typename T>
+        void Disable(EntityId eId);
+
+        template<typename T>
+        bool IsEnabled(EntityId eId);
+
         template<typename T>
         void Set(EntityId eId, T&& c);
 
@@ -87,11 +152,49 @@ namespace ECS
 
         void Set(EntityId eId, EntityId cId, const void* data);
 
+        //mutable access, marks the column of the entity's chunk as changed
         void* Get(EntityId eId, EntityId cId);
 
+        const void* GetConst(EntityId eId, EntityId cId);
+
+        //archetype column or sparse slot of the component, ti is its type, null for SoA columns
+        //a write stamps the column of the entity's chunk with the change tick
+        void* GetComponentData(EntityId eId, EntityId cId, TypeInfo*& ti, bool isWrite);
+
+        //data column of a component in the archetype, -1 when missing or a tag
+        int32_t GetColumnIndex(Archetype* archetype, EntityId cId);
+
+        void InitArchetypeChunkLayout(Archetype& archetype);
+
+        void* AllocArchetypeChunk(Archetype& archetype);
+
+        void FreeArchetypeChunk(Archetype& archetype, void* chunk);
+
         void GrowArchetype(Archetype& archetype);
 
-        void SwapBack(EntityRecord& r);
+        //allocates every chunk needed for count more rows
+        void ReserveArchetype(Archetype& archetype, uint32_t count);
+
+        //frees trailing empty chunks, one is kept so a row removed and added at a chunk boundary does not reallocate
+        void ShrinkArchetype(Archetype& archetype);
+
+        //fills the row from the back row, its data must be moved out or destroyed first
+        void RemoveRow(Archetype& archetype, uint32_t row);
+
+        //copies the enable bits shared with src, the other toggles of the row start enabled
+        void MoveToggleBits(Archetype& destArchetype, uint32_t destRow, Archetype* srcArchetype, uint32_t srcRow);
+
+        //stamps every column of the chunk with the current change tick
+        void MarkChunkChanged(Archetype& archetype, uint32_t chunkIdx);
+
+        //depth of the archetypes holding (ChildOf, parent)
+        uint32_t GetChildDepth(EntityId parent);
+
+        //called when the depth of an entity changed, walks its subtree while the depth differs
+        void UpdateChildDepth(EntityId parent);
+
+        //match indices of the query sorted by depth, only when a match or the hierarchy changed
+        void SortCascadeOrder(Query* query);
 
         Archetype* CreateArchetype(ComponentSet&& componentSet);
 
@@ -104,15 +207,121 @@ namespace ECS
         void MoveArchetype_Add(EntityId eId, EntityRecord& r, Archetype* destArchetype);
         void MoveArchetype_Remove(EntityId eId, EntityRecord& r, Archetype* destArchetype);
 
-        //NOTE: System store list of cache archetypes, but the list can be invalidated at runtime,
-        //so I need to find a new way to re-validate this or rewrite this in a different way
-        //basically, I have to introduce sync point
+        //any mix of added and removed components, null dest leaves the entity empty
+        void MoveArchetype(EntityId eId, EntityRecord& r, Archetype* destArchetype);
+
+        //a single memcpy for TRIVIALLY_RELOCATABLE types, detected or set through TriviallyRelocatable(),
+        //otherwise moves or copies then destroys element by element
+        void MoveColumnRange(TypeInfo& ti, void* dest, void* src, uint32_t count);
+
+        //row ranges stay inside one chunk, structure of arrays columns go field by field
+        void MoveColumnRows(Archetype& dest, uint32_t destColIdx, uint32_t destRow,
+                            Archetype& src, uint32_t srcColIdx, uint32_t srcRow, uint32_t count);
+        void ConstructColumnRows(Archetype& archetype, uint32_t colIdx, uint32_t row, uint32_t count);
+
+        //scatters a whole component into the field streams of a structure of arrays column
+        void WriteSoaRow(Archetype& archetype, uint32_t colIdx, uint32_t row, const void* value);
+
+        //moves every row of src at the end of dest, null dest leaves the entities empty
+        void MoveArchetypeAll(Archetype* srcArchetype, Archetype* destArchetype);
+
+        //adds or removes one component on every entity matched by the query, table by table
+        void BulkAddComponent(Query* query, EntityId cId);
+        void BulkRemoveComponent(Query* query, EntityId cId);
+
+        template<typename T, typename... Components>
+        void BulkAddComponent();
+
+        template<typename T, typename... Components>
+        void BulkRemoveComponent();
+
+        void CreateSparseStorage(TypeInfo& ti);
+
+        //null when the component is stored in archetypes
+        SparseStorage* GetSparseStorage(EntityId cId);
+
+        //constructs the component in its slot, returns its data, null for tags
+        void* AddSparse(SparseStorage& storage, EntityId eId);
+        void RemoveSparse(SparseStorage& storage, EntityId eId);
+
+        void GrowSparseStorage(SparseStorage& storage);
+
+        //the callback gets every entity the event hit on cId since the last flush
+        void Observe(EventType type, EntityId cId, ObserverCallback callback, void* ctx = nullptr);
+
+        //called once per flush with the entities that entered (OnAdd) or left (OnRemove) the query
+        //through one of its terms, or had a term set (OnSet), cId is 0
+        void Observe(EventType type, Query* query, ObserverCallback callback, void* ctx = nullptr);
+
+        template<typename T>
+        void Observe(EventType type, ObserverCallback callback, void* ctx = nullptr);
+
+        template<typename... Components>
+        void ObserveQuery(EventType type, ObserverCallback callback, void* ctx = nullptr);
+
+        EventBuffer& GetOrCreateEventBuffer(EventType type, EntityId cId);
+
+        //queued only when the component is observed, query observers test the archetype the entity
+        //is in after an add or a set, and the one it was in before a remove
+        void Emit(EventType type, EntityId cId, EntityId eId, Archetype* archetype);
+        void EmitRows(EventType type, EntityId cId, Archetype& archetype, uint32_t firstRow, uint32_t count);
+
+        //calls the observers once per buffer, events emitted by them are flushed in the same call
+        void FlushEvents();
+
+        //the event term always counts as met, a removed sparse component is already gone
+        bool IsObservedBy(Query* query, EntityId cId, EntityId eId, Archetype* archetype);
+
+        void InitCommandBuffers();
+        void DestroyCommandBuffers();
+
+        //buffer of the calling thread
+        CommandBuffer& GetCommandBuffer();
+
+        //applies every deferred command, one archetype move per entity
+        void MergeCommandBuffers();
+
+        void MergeEntityCommands(const Command* commands, uint32_t count);
+
+        //destroys the data of the sets of a dropped command group
+        void DestroyCommandData(const Command* commands, uint32_t count);
+
+        //terms may hold AnyTarget(relation) and AnyRelation(target) wildcards
+        Query* GetOrCreateQuery(const EntityId* ids, uint32_t count);
+
+        Query* CreateQuery(const EntityId* ids, uint32_t count);
+
+        //record of the (*, target) index, every archetype holding a pair to the target
+        ComponentRecord& GetOrCreateTargetRecord(EntityId target);
+
+        //archetypes a term can match, null when none was created yet
+        ComponentRecord* GetTermRecord(EntityId term);
+
+        void MatchQueries(Archetype* archetype);
+
+        void RunQuery(Query* query, SystemCallback& sc);
+
+        void RunQueryChunk(Query* query, SystemCallback& sc, uint32_t matchIdx, uint32_t chunkIdx);
+
+        bool IsSystemConflict(SystemCallback& first, SystemCallback& sec);
+
+        bool IsSystemDependOn(SystemCallback& sc, SystemCallback& other);
+
+        void BuildSchedule();
+
+        void RunScheduleStage(uint32_t first, uint32_t last);
+
+        //returns the system entity, add (DependOn, other system) to it to force ordering
+        template<typename... Components, typename... FuncArgs>
+        Entity System(void (*func)(FuncArgs...), uint32_t flags = 0);
 
+        //SYSTEM_CASCADE visits parents before children
         template<typename... Components, typename... FuncArgs>
-        void System(void (*func)(FuncArgs...));
+        void Each(void (*func)(FuncArgs...), uint32_t flags = 0);
 
+        //extra terms follow the components, they filter but are not passed, e.g. AnyTarget(ChildOfId)
         template<typename... Components, typename... FuncArgs>
-        void Each(void (*func)(FuncArgs...));
+        void Each(void (*func)(FuncArgs...), const EntityId* extraTerms, uint32_t extraCount, uint32_t flags = 0);
 
         void Progress(double dt);
 
@@ -121,15 +330,37 @@ namespace ECS
     public:
         WorldAllocator m_wAllocator;
         Allocators m_allocators;
+        JobSystem m_jobSystem;
+        CommandBuffer* m_commandBuffers; //one per thread of the job system
+        uint32_t m_commandBufferCount;
+        Store<Command> m_mergedCommands;
+        std::atomic<uint32_t> m_deferredNextId;
         SparseSet<EntityRecord> m_entityIndex;
+        SparseSet<uint32_t> m_denseIndices; //dense index of every component id that has one
+        SparseSet<SparseStorage*> m_sparseStorages; //storage of every sparse component id
         SparseSet<Archetype> m_archetypes;
         HashMap<EntityId, ComponentRecord> m_componentIndex;
         HashMap<EntityId, TypeInfo*> m_typeInfos;
         HashMap<ComponentSet, Archetype*> m_mappedArchetype; //value hold a ref to key, does not change the value's key ref
-        Store<EntityId> m_componentStore;
         Store<SystemCallback> m_systemStore;
+        Store<uint32_t> m_schedule; //system indices sorted by stage
+        Store<uint32_t> m_scheduleStages; //end offset of every stage in m_schedule
+        Store<Query*> m_queryStore;
+        HashMap<ComponentSet, Query*> m_queryCache; //value hold a ref to key, same as mapped archetype
+        Store<EventBuffer> m_eventBuffers;
+        HashMap<EntityId, uint32_t> m_eventBufferIndex[EventTypeCount]; //buffer of every observed component
+        Store<EntityId> m_flushedEvents; //entities of the buffer being dispatched
+        Store<QueryEventBuffer> m_queryEventBuffers;
+        Store<EntityId> m_destroyQueue; //victims of a destroy, their children are appended
+        Store<EntityId> m_deferredDestroys; //destroyed by commands, as one batch after the merge
+        Store<EntityId> m_droppedPairs; //pairs to a destroyed target, removed with its archetypes
         uint32_t m_nextFreeId;
+        uint32_t m_denseIndexCount; //next signature bit handed to a registered type
+        uint32_t m_changeTick; //advanced before every schedule stage and after the last one
+        uint32_t m_hierarchyVersion; //advanced when the depth of an archetype changes
+        bool m_isFlushing;
         bool m_isDefered;
+        bool m_isScheduleDirty;
     };
 }
 
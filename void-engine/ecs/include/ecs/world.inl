@@ -12,9 +12,23 @@ namespace ECS
         //Entity e = CreateEntity(ComponentName<Component>::name, 0);
         //ti->id = e.GetFullId();
 
+        if constexpr(std::is_trivially_copyable_v<T>)
+        {
+            ti->flags |= TRIVIALLY_RELOCATABLE;
+        }
+
         assert(std::is_destructible_v<T>);
         assert(std::is_trivially_constructible_v<T>);
 
+        //rows of a SoA column are moved and constructed field by field, without hooks
+        if constexpr(is_soa_component_v<T>)
+        {
+            static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                          "SoA components must be trivially copyable and destructible!");
+
+            ti->soa = &SoaFields<T>::layout;
+        }
+
         TypeInfoBuilder<T> tiBuilder{*ti, this};
 
         tiBuilder.Ctor(
@@ -54,28 +68,6 @@ namespace ECS
             );
         }
 
-
-        tiBuilder.AddEvent(
-            []()
-            {
-                std::cout << "Add component " << ComponentName<T>::name << std::endl;
-            }
-        );
-
-        tiBuilder.RemoveEvent(
-            []()
-            {
-                std::cout << "Remove component" << ComponentName<T>::name << std::endl;
-            }
-        );
-
-        tiBuilder.SetEvent(
-            [](void* dest)
-            {
-                std::cout << "Set component" << ComponentName<T>::name << std::endl;
-            }
-        );
-
         return tiBuilder;
     }
 
@@ -95,28 +87,6 @@ namespace ECS
 
         TypeInfoBuilder<T> tiBuilder{*ti, this};
 
-
-        tiBuilder.AddEvent(
-            []()
-            {
-                std::cout << "Add tag " << ComponentName<T>::name << std::endl;
-            }
-        );
-
-        tiBuilder.RemoveEvent(
-            []()
-            {
-                std::cout << "Remove tag" << ComponentName<T>::name << std::endl;
-            }
-        );
-
-        tiBuilder.SetEvent(
-            [](void* dest)
-            {
-                std::cout << "Set tag" << ComponentName<T>::name << std::endl;
-            }
-        );
-
         return tiBuilder;
     }
 
@@ -129,16 +99,27 @@ namespace ECS
 
         ti->flags = PAIR_TYPE;
 
-        if(ti->size > 1 || isToggle)
+        if(ti->size > 1)
         {
             ti->flags |= TYPE_HAS_DATA;
         }
 
+        //the pair data is a bitset over the rows of the archetype
+        if(isToggle)
+        {
+            ti->flags |= (TYPE_HAS_DATA | BITSET_DATA);
+        }
+
         if(isExclusive)
         {
             ti->flags |= EXCLUSIVE_PAIR;
         }
 
+        if constexpr(std::is_trivially_copyable_v<T>)
+        {
+            ti->flags |= TRIVIALLY_RELOCATABLE;
+        }
+
         ti->id = 0;
 
         assert(std::is_destructible_v<T>);
@@ -186,28 +167,68 @@ namespace ECS
             }
         }
 
-        tiBuilder.AddEvent(
-            []()
-            {
-                std::cout << "Add pair " << ComponentName<T>::name << std::endl;
-            }
-        );
+        return tiBuilder;
+    }
 
-        tiBuilder.RemoveEvent(
-            []()
-            {
-                std::cout << "Remove pair" << ComponentName<T>::name << std::endl;
-            }
-        );
+    template<typename... Components>
+    EntityId World::CreateEntities(uint32_t count)
+    {
+        EntityId ids[] = {ComponentTypeId<Components>::id...};
 
-        tiBuilder.SetEvent(
-            [](void* dest)
+        ComponentSet cs;
+        cs.idArr = ids;
+        cs.count = sizeof...(Components);
+        cs.Sort();
+
+        const void* const* noValues = nullptr;
+
+        return CreateEntities(count, cs, noValues);
+    }
+
+    template<typename... Components>
+    EntityId World::CreateEntities(uint32_t count, const Components&... values)
+    {
+        static_assert((!std::is_same_v<Components, ComponentSet> && ...),
+                      "Component set overload takes values as const void* const*");
+
+        constexpr uint32_t idCount = sizeof...(Components);
+
+        EntityId ids[] = {ComponentTypeId<Components>::id...};
+        const void* data[] = {&values...};
+
+        //sort ids and values together, sets are small
+        for(uint32_t i = 1; i < idCount; i++)
+        {
+            for(uint32_t j = i; j > 0 && ids[j - 1] > ids[j]; j--)
             {
-                std::cout << "Set pair" << ComponentName<T>::name << std::endl;
+                std::swap(ids[j - 1], ids[j]);
+                std::swap(data[j - 1], data[j]);
             }
-        );
+        }
 
-        return tiBuilder;
+        ComponentSet cs;
+        cs.idArr = ids;
+        cs.count = idCount;
+
+        const void* const* sortedValues = data;
+
+        return CreateEntities(count, cs, sortedValues);
+    }
+
+    template<typename T, typename... Components>
+    void World::BulkAddComponent()
+    {
+        EntityId ids[] = {ComponentTypeId<Components>::id...};
+
+        BulkAddComponent(GetOrCreateQuery(ids, sizeof...(Components)), ComponentTypeId<T>::id);
+    }
+
+    template<typename T, typename... Components>
+    void World::BulkRemoveComponent()
+    {
+        EntityId ids[] = {ComponentTypeId<T>::id, ComponentTypeId<Components>::id...};
+
+        BulkRemoveComponent(GetOrCreateQuery(ids, sizeof...(Components) + 1), ComponentTypeId<T>::id);
     }
 
     template<typename T>
@@ -219,6 +240,12 @@ namespace ECS
     template<typename T>
     void World::AddPair(EntityId id, EntityId second)
     {
+        if(m_isDefered)
+        {
+            GetCommandBuffer().Push(CommandType::AddComponent, id, MakePair(ComponentTypeId<T>::id, second));
+            return;
+        }
+
         EntityId pairId = MakePair(ComponentTypeId<T>::id, second);
         TypeInfo* pTi = m_typeInfos.GetValue(ComponentTypeId<T>::id);
         
@@ -233,12 +260,13 @@ namespace ECS
             builder.Register();
         }
 
+        assert(IsAlive(id) && "Entity is not alive!");
         EntityRecord* r = m_entityIndex.GetPageData(id);
 
         assert(r);
-        assert(!r->archetype->components.Has(pairId));
+        assert(!r->archetype || !r->archetype->components.Has(pairId));
 
-        if(pTi->IsExclusive())
+        if(pTi->IsExclusive() && r->archetype)
         {
             if(r->archetype->components.HasPair(ComponentTypeId<T>::id))
             {
@@ -246,185 +274,97 @@ namespace ECS
             }
         }
 
-        Archetype* destArchetype = GetOrCreateArchetype_Add(r->archetype, pairId);
-
-        if(destArchetype->count == destArchetype->capacity)
+        if(ComponentTypeId<T>::id == DependOnId)
         {
-            GrowArchetype(*destArchetype);
-        }
-
-        if(!r->archetype)
-        {
-            if(pTi->HasData())
-            {
-                void* dataAddr = OFFSET(destArchetype->columns[0].data, destArchetype->count * pTi->size);
-                pTi->hook.ctor(dataAddr);
-            }
+            m_isScheduleDirty = true;
         }
-        else
-        {
-            SwapBack(*r);
-
-            for(uint32_t i = 0; i < destArchetype->components.count; i++)
-            {
-                //skip no data tag and pair
-                int32_t destColIdx = destArchetype->componentMap[i];
-
-                if(destColIdx == -1)
-                {
-                    continue;
-                }
-
-                Column& destCol = destArchetype->columns[destColIdx];
-                TypeInfo& ti = *destCol.typeInfo;
-
-                void* dest = OFFSET(destCol.data, ti.size * destArchetype->count);
-
-                int32_t srcIndex = r->archetype->components.Search(destArchetype->components.idArr[i]);
-
-                if(srcIndex == -1)
-                {
-                    ti.hook.ctor(dest);
-                }
-                else
-                {
-                    int32_t srcColIdx = r->archetype->componentMap[srcIndex];
-
-                    if(srcColIdx == -1)
-                    {
-                        assert(0 && "Mismatch type");
-                    }
-
-                    Column& srcCol = r->archetype->columns[srcColIdx];
-                    void* src = OFFSET(srcCol.data, ti.size * r->row);
-
-                    if(ti.hook.moveCtor)
-                    {
-                        ti.hook.moveCtor(dest, src);
-                    }
-                    else if(ti.hook.copyCtor)
-                    {
-                        ti.hook.copyCtor(dest, src);
-                    }
-                    else
-                    {
-                        std::memcpy(dest, src, ti.size);
-                    }
-
-                    if(ti.hook.dtor)
-                    {
-                        ti.hook.dtor(src);
-                    }
-                }
-            }
 
-            --r->archetype->count;
-        }
+        Archetype* destArchetype = GetOrCreateArchetype_Add(r->archetype, pairId);
 
-        destArchetype->entities[destArchetype->count] = id;
-        r->archetype = destArchetype;
-        r->row = destArchetype->count;
-        ++destArchetype->count;
+        MoveArchetype_Add(id, *r, destArchetype);
 
-        pTi->hook.onAdd();
+        Emit(EventType::OnAdd, pairId, id, r->archetype);
     }
 
     template<typename T>
     void World::AddTag(EntityId id)
     {
+        if(m_isDefered)
+        {
+            GetCommandBuffer().Push(CommandType::AddComponent, id, ComponentTypeId<T>::id);
+            return;
+        }
+
+        assert(IsAlive(id) && "Entity is not alive!");
         EntityRecord* r = m_entityIndex.GetPageData(id);
 
         assert(r);
 
         TypeInfo* pti = m_typeInfos.GetValue(ComponentTypeId<T>::id);
 
-        assert(!r->archetype->components.Has(ComponentTypeId<T>::id));
-
-        if(pti->IsExclusive())
+        if(pti->IsSparse())
         {
-            assert(!r->archetype->components.HasPair(ComponentTypeId<T>::id));
+            AddSparse(*GetSparseStorage(ComponentTypeId<T>::id), id);
+            Emit(EventType::OnAdd, ComponentTypeId<T>::id, id, r->archetype);
+            return;
         }
 
-        Archetype* destArchetype = GetOrCreateArchetype_Add(r->archetype, ComponentTypeId<T>::id);
+        assert(!r->archetype || !r->archetype->components.Has(ComponentTypeId<T>::id));
 
-        if(destArchetype->count == destArchetype->capacity)
+        if(pti->IsExclusive() && r->archetype)
         {
-            GrowArchetype(*destArchetype);
+            assert(!r->archetype->components.HasPair(ComponentTypeId<T>::id));
         }
 
-        if(r->archetype)
-        {
-            SwapBack(*r);
-
-
-            for(uint32_t i = 0; i < destArchetype->components.count; i++)
-            {
-                //skip no data tag and pair
-                int32_t destColIdx = destArchetype->componentMap[i];
-
-                if(destColIdx == -1)
-                {
-                    continue;
-                }
-
-                Column& destCol = destArchetype->columns[destColIdx];
-                TypeInfo& ti = *destCol.typeInfo;
-
-                void* dest = OFFSET(destCol.data, ti.size * destArchetype->count);
+        Archetype* destArchetype = GetOrCreateArchetype_Add(r->archetype, ComponentTypeId<T>::id);
 
-                int32_t srcIndex = r->archetype->components.Search(destArchetype->components.idArr[i]);
+        MoveArchetype_Add(id, *r, destArchetype);
 
-                if(srcIndex == -1)
-                {
-                    ti.hook.ctor(dest);
-                }
-                else
-                {
-                    int32_t srcColIdx = r->archetype->componentMap[srcIndex];
+        Emit(EventType::OnAdd, ComponentTypeId<T>::id, id, r->archetype);
+    }
 
-                    if(srcColIdx == -1)
-                    {
-                        assert(0 && "Mismatch type");
-                    }
+    template<typename T>
+    void World::RemoveComponent(EntityId eId)
+    {
+        RemoveComponent(eId, ComponentTypeId<T>::id);
+    }
 
-                    Column& srcCol = r->archetype->columns[srcColIdx];
-                    void* src = OFFSET(srcCol.data, ti.size * r->row);
+    template<typename T>
+    void World::Observe(EventType type, ObserverCallback callback, void* ctx)
+    {
+        Observe(type, ComponentTypeId<T>::id, callback, ctx);
+    }
 
-                    if(ti.hook.moveCtor)
-                    {
-                        ti.hook.moveCtor(dest, src);
-                    }
-                    else if(ti.hook.copyCtor)
-                    {
-                        ti.hook.copyCtor(dest, src);
-                    }
-                    else
-                    {
-                        std::memcpy(dest, src, ti.size);
-                    }
+    template<typename... Components>
+    void World::ObserveQuery(EventType type, ObserverCallback callback, void* ctx)
+    {
+        EntityId ids[] = {ComponentTypeId<Components>::id...};
 
-                    if(ti.hook.dtor)
-                    {
-                        ti.hook.dtor(src);
-                    }
-                }
-            }
+        Observe(type, GetOrCreateQuery(ids, sizeof...(Components)), callback, ctx);
+    }
 
-            --r->archetype->count;
-        }
+    template<typename T>
+    void World::AddToggle(EntityId eId)
+    {
+        AddToggle(eId, ComponentTypeId<T>::id);
+    }
 
-        destArchetype->entities[destArchetype->count] = id;
-        r->archetype = destArchetype;
-        r->row = destArchetype->count;
-        ++destArchetype->count;
+    template<typename T>
+    void World::Enable(EntityId eId)
+    {
+        SetEnabled(eId, ComponentTypeId<T>::id, true);
+    }
 
-        pti->hook.onAdd();
+    template<typename T>
+    void World::Disable(EntityId eId)
+    {
+        SetEnabled(eId, ComponentTypeId<T>::id, false);
     }
 
     template<typename T>
-    void World::RemoveComponent(EntityId eId)
+    bool World::IsEnabled(EntityId eId)
     {
-        RemoveComponent(eId, ComponentTypeId<T>::id);
+        return IsEnabled(eId, ComponentTypeId<T>::id);
     }
 
     template<typename T>
@@ -436,61 +376,37 @@ namespace ECS
     template<typename T>
     T& World::Get(EntityId eId)
     {
-        void* data = Get(eId, ComponentTypeId<T>::id);
+        static_assert(!is_soa_component_v<T>, "SoA components are accessed through Soa<T> views!");
 
-        T& component = PTR_CAST(data, CompTonent);
+        //Get<const T> leaves the change tick as is
+        if constexpr(std::is_const_v<T>)
+        {
+            const void* data = GetConst(eId, ComponentTypeId<decay_t<T>>::id);
+
+            return *PTR_CAST(data, T);
+        }
+        else
+        {
+            void* data = Get(eId, ComponentTypeId<T>::id);
+
+            T& component = *PTR_CAST(data, T);
 
-        return component;
+            return component;
+        }
     }
 
     template<typename... Components, typename... FuncArgs>
-    void World::System(void (*func)(FuncArgs...))
+    Entity World::System(void (*func)(FuncArgs...), uint32_t flags)
     {
         EntityId ids[] = {ComponentTypeId<Components>::id...};
         uint32_t count = sizeof...(Components);
-        ComponentSet componentSet;
-        componentSet.Alloc(m_wAllocator, count);
-        componentSet.count = count;
-        std::memcpy(componentSet.idArr, ids, count * sizeof(EntityId));
-
-        ArchetypeLinkedList* node = ArchetypeLinkedList::Alloc(m_wAllocator);
-
-        ArchetypeLinkedList* head = node;
 
         SystemCallback sc = CreateSystemCallback<Components..., FuncArgs...>(func);
+        sc.query = GetOrCreateQuery(ids, count);
+        sc.flags = flags;
 
-        for(uint32_t idx = 0; idx < 1; idx++)
-        {
-            ComponentRecord& cr = m_componentIndex.GetValue(ids[idx]);
-
-            for(uint32_t aIdx = 0; aIdx < cr.archetypeStore.count; aIdx++)
-            {
-                Archetype* archetype = cr.archetypeStore.store[aIdx];
-                bool skip = false;
-                assert(archetype);
-
-                for(uint32_t remainIdx = 1; remainIdx < count; remainIdx++)
-                {
-                    //Archetype does not contain the same set of components
-                    if(!archetype->components.Has(ids[remainIdx]) &&
-                       !archetype->components.HasPair(ids[remainIdx]))
-                    {
-                        skip = true;
-                    }
-                }
-
-                if(!skip)
-                {
-                    node->archetype = archetype;
-                    ArchetypeLinkedList* newNode = ArchetypeLinkedList::Alloc(m_wAllocator);
-                    node->next = newNode;
-                    node = newNode;
-                }
-            }
-        }
-
-        sc.components = std::move(componentSet);
-        sc.archetypeList = head;
+        Entity e = CreateEntity();
+        sc.entity = e.GetFullId();
 
         if(m_systemStore.capacity == m_systemStore.count)
         {
@@ -498,93 +414,61 @@ namespace ECS
         }
 
         m_systemStore.Add(sc);
+        m_isScheduleDirty = true;
+
+        return e;
     }
 
     template<typename... Components, typename... FuncArgs>
-    void World::Each(void (*func)(FuncArgs...))
+    void World::Each(void (*func)(FuncArgs...), uint32_t flags)
     {
         EntityId ids[] = {ComponentTypeId<decay_t<Components>>::id...};
         uint32_t count = sizeof...(Components);
 
-        ArchetypeLinkedList* node = ArchetypeLinkedList::Alloc(m_wAllocator);
-
-        ArchetypeLinkedList* head = node;
-
         SystemCallback sc = CreateSystemCallback<Components..., FuncArgs...>(func);
+        sc.flags = flags;
+        Query* query = GetOrCreateQuery(ids, count);
 
-        for(uint32_t idx = 0; idx < 1; idx++)
-        {
-            ComponentRecord& cr = m_componentIndex.GetValue(ids[idx]);
-
-            for(uint32_t aIdx = 0; aIdx < cr.archetypeStore.count; aIdx++)
-            {
-                Archetype* archetype = cr.archetypeStore.store[aIdx];
-                bool skip = false;
-                assert(archetype);
-
-                for(uint32_t remainIdx = 1; remainIdx < count; remainIdx++)
-                {
-                    //Archetype does not contain the same set of components
-                    if(archetype->components.Search(ids[remainIdx]) == -1)
-                    {
-                        skip = true;
-                        break;
-                    }
-                }
+        RunQuery(query, sc);
+    }
 
-                if(!skip)
-                {
-                    node->archetype = archetype;
-                    ArchetypeLinkedList* newNode = ArchetypeLinkedList::Alloc(m_wAllocator);
-                    node->next = newNode;
-                    node = newNode;
-                }
-            }
-        }
+    template<typename... Components, typename... FuncArgs>
+    void World::Each(void (*func)(FuncArgs...), const EntityId* extraTerms, uint32_t extraCount, uint32_t flags)
+    {
+        constexpr uint32_t componentCount = sizeof...(Components);
 
-        void* componentsData[sizeof...(FuncArgs)];
+        assert(componentCount + extraCount <= MaxQueryTermCount && "Query has too many terms!");
 
-        while(head->archetype)
-        {
-            Archetype* archetype = head->archetype;
+        EntityId ids[MaxQueryTermCount] = {ComponentTypeId<decay_t<Components>>::id...};
+        std::memcpy(ids + componentCount, extraTerms, sizeof(EntityId) * extraCount);
 
-            for(uint32_t row = 0; row < archetype->count; row++)
-            {
-                QueryIterator it;
-                it.archetype = archetype;
-                it.world = this;
-                it.row = row;
+        SystemCallback sc = CreateSystemCallback<Components..., FuncArgs...>(func);
+        sc.flags = flags;
+        Query* query = GetOrCreateQuery(ids, componentCount + extraCount);
 
-                for(uint32_t idx = 0; idx < count; idx++)
-                {
-                    uint32_t componentId = ids[idx];
+        RunQuery(query, sc);
+    }
 
-                    int32_t cIdx = archetype->components.Search(componentId);
+    template<typename Component>
+    Component& QueryIterator::Get()
+    {
+        static_assert(!is_soa_component_v<Component>, "SoA components are accessed through Soa<T> views!");
 
-                    assert(cIdx != -1);
+        int32_t colIdx = world->GetColumnIndex(archetype, ComponentTypeId<decay_t<Component>>::id);
 
-                    int32_t colIdx = archetype->componentMap[cIdx];
+        //sparse components are not in the archetype
+        if(colIdx == -1)
+        {
+            return world->Get<Component>(archetype->GetEntity(row));
+        }
 
-                    if(colIdx == -1)
-                    {
-                        componentsData[idx] = nullptr;
-                    }
-                    else
-                    {
-                        Column& col = archetype->columns[colIdx];
-                        TypeInfo& ti = *col.typeInfo;
-                        void* comData = OFFSET(col.data, ti.size * row);
-                        componentsData[idx] = comData;
-                    }
-                }
+        if constexpr(!std::is_const_v<Component>)
+        {
+            archetype->GetChunkTicks(archetype->GetChunkIndex(row))[colIdx] = world->m_changeTick;
+        }
 
-                //EXECUTE
-                sc.Execute(&it, componentsData);
-            }
-            ArchetypeLinkedList* freeNode = head;
-            head = head->next;
+        void* comData = archetype->GetColumnData(colIdx, row);
 
-            ArchetypeLinkedList::Free(m_wAllocator, freeNode);
-        }
+        return *PTR_CAST(comData, Component);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,112 @@
+#include "command_buffer.h"
+
+namespace ECS
+{
+    void CommandBuffer::Init()
+    {
+        m_capacity = CommandBufferDefaultCapacity;
+        m_count = 0;
+        m_commands = PTR_CAST(std::malloc(sizeof(Command) * m_capacity), Command);
+
+        assert(m_commands && "Command buffer is null!");
+
+        m_blockHead = CreateBlock(CommandDataBlockSize);
+        m_block = m_blockHead;
+    }
+
+    void CommandBuffer::Destroy()
+    {
+        CommandDataBlock* block = m_blockHead;
+
+        while(block)
+        {
+            CommandDataBlock* freeBlock = block;
+            block = block->next;
+
+            std::free(freeBlock);
+        }
+
+        std::free(m_commands);
+
+        m_commands = nullptr;
+        m_blockHead = nullptr;
+        m_block = nullptr;
+        m_count = 0;
+        m_capacity = 0;
+    }
+
+    void CommandBuffer::Push(CommandType type, EntityId entity, EntityId id, void* data)
+    {
+        if(m_count == m_capacity)
+        {
+            uint32_t newCapacity = m_capacity * 2;
+            Command* newCommands = PTR_CAST(std::malloc(sizeof(Command) * newCapacity), Command);
+
+            assert(newCommands && "Command buffer is null!");
+
+            std::memcpy(newCommands, m_commands, sizeof(Command) * m_count);
+            std::free(m_commands);
+
+            m_commands = newCommands;
+            m_capacity = newCapacity;
+        }
+
+        Command& cmd = m_commands[m_count];
+        cmd.type = type;
+        cmd.entity = entity;
+        cmd.id = id;
+        cmd.data = data;
+
+        ++m_count;
+    }
+
+    void* CommandBuffer::PushData(uint32_t size, uint32_t alignment)
+    {
+        while(true)
+        {
+            uintptr_t start = RCAST(m_block, uintptr_t) + sizeof(CommandDataBlock);
+            uintptr_t mask = alignment - 1;
+            uintptr_t addr = (start + m_block->used + mask) & ~mask;
+            uint32_t used = CAST(addr - start, uint32_t) + size;
+
+            if(used <= m_block->size)
+            {
+                m_block->used = used;
+                return RCAST(addr, void*);
+            }
+
+            if(!m_block->next)
+            {
+                m_block->next = CreateBlock(std::max(CommandDataBlockSize, size + alignment));
+            }
+
+            m_block = m_block->next;
+        }
+    }
+
+    void CommandBuffer::Clear()
+    {
+        m_count = 0;
+
+        for(CommandDataBlock* block = m_blockHead; block; block = block->next)
+        {
+            block->used = 0;
+        }
+
+        m_block = m_blockHead;
+    }
+
+    CommandDataBlock* CommandBuffer::CreateBlock(uint32_t size)
+    {
+        CommandDataBlock* block = 
+            PTR_CAST(std::malloc(sizeof(CommandDataBlock) + size), CommandDataBlock);
+
+        assert(block && "Command data block is null!");
+
+        block->next = nullptr;
+        block->size = size;
+        block->used = 0;
+
+        return block;
+    }
+}
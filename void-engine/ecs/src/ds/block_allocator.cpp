@@ -7,11 +7,39 @@ namespace ECS
         assert(size && "Data Size is 0!");
         m_chunkSize = Align(size, MinChunkAlign);
         m_chunkCount = std::max<uint32_t>(PageSize / m_chunkSize, 1);
-        m_blockSize = m_chunkCount * m_chunkSize;
+        InitBlockSize();
         m_blockHead = nullptr;
         m_chunkHead = nullptr;
     }
 
+    void BlockAllocator::Init(uint32_t size, uint32_t chunkCount)
+    {
+        assert(size && "Data Size is 0!");
+        assert(chunkCount && "Chunk Count is 0!");
+        m_chunkSize = Align(size, MinChunkAlign);
+        m_chunkCount = chunkCount;
+        InitBlockSize();
+        m_blockHead = nullptr;
+        m_chunkHead = nullptr;
+    }
+
+    void BlockAllocator::InitBlockSize()
+    {
+        if(m_chunkCount <= MinChunkCount)
+        {
+            m_blockSize = m_chunkSize;
+            return;
+        }
+
+        //lowest set bit of the chunk size, every chunk keeps the alignment of the first one
+        uint32_t chunkAlign = std::min(m_chunkSize & (~m_chunkSize + 1), MaxChunkAlign);
+        m_chunkOffset = Align(sizeof(BlockAllocatorBlock), chunkAlign);
+
+        //the power of 2 round up is filled with chunks instead of left unused
+        m_blockSize = RoundMinPowerOf2(m_chunkOffset + m_chunkCount * m_chunkSize, PageSize);
+        m_chunkCount = (m_blockSize - m_chunkOffset) / m_chunkSize;
+    }
+
     void* BlockAllocator::Alloc()
     {
         if(m_chunkCount <= MinChunkCount)
@@ -63,23 +91,10 @@ namespace ECS
             return;
         }
         
-        BlockAllocatorBlock* block = m_blockHead;
-        
-        while(true)
-        {
-            assert(block && "Free memory is not belonged to this pool!");
-
-            uintptr_t bStart = RCAST(block, uintptr_t);
-            uintptr_t bEnd = bStart + sizeof(BlockAllocatorBlock) + m_chunkCount * m_chunkSize;
-            uintptr_t a = RCAST(addr, uintptr_t);
-            
-            if(a >= bStart && a < bEnd)
-            {
-                break;
-            }
+        BlockAllocatorBlock* block = RCAST(RCAST(addr, uintptr_t) & ~(CAST(m_blockSize, uintptr_t) - 1), BlockAllocatorBlock*);
 
-            block = block->next;
-        }
+        assert(block->owner == this && "Free memory is not belonged to this pool!");
+        (void)block;
 
         BlockAllocatorChunk* freeChunk = static_cast<BlockAllocatorChunk*>(addr);
 
@@ -93,16 +108,16 @@ namespace ECS
     {
         BlockAllocatorBlock* block = 
             static_cast<BlockAllocatorBlock*>(
-                std::malloc(sizeof(BlockAllocatorBlock) + m_chunkCount * m_chunkSize)
+                AlignedAlloc(m_blockSize, m_blockSize)
             );
 
         assert(block && "Malloc block is null!");
 
         BlockAllocatorChunk* firstChunk = reinterpret_cast<BlockAllocatorChunk*>(
-                reinterpret_cast<uintptr_t>(block) + sizeof(BlockAllocatorBlock)
+                reinterpret_cast<uintptr_t>(block) + m_chunkOffset
             );
 
-        block->firstChunk = firstChunk;
+        block->owner = this;
         block->next = m_blockHead;
         m_blockHead = block;
 
@@ -112,7 +127,7 @@ namespace ECS
         for(uint32_t i = 1; i < m_chunkCount; ++i)
         {
             chunk->next = reinterpret_cast<BlockAllocatorChunk*>(
-                    reinterpret_cast<uintptr_t>(block->firstChunk) + m_chunkSize * i
+                    reinterpret_cast<uintptr_t>(firstChunk) + m_chunkSize * i
                 );
             chunk = chunk->next;
         }
@@ -130,7 +145,7 @@ namespace ECS
             auto freeBlock = block;
             block = block->next;
 
-            std::free(freeBlock);
+            AlignedFree(freeBlock);
         }
     }
 
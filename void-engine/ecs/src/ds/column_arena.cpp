@@ -0,0 +1,97 @@
+#include "ds/column_arena.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace ECS
+{
+    void ColumnArena::Init(uint64_t reserveSize)
+    {
+        m_reserved = (reserveSize + ColumnArenaPageSize - 1) & ~(ColumnArenaPageSize - 1);
+        m_committed = 0;
+
+#if defined(_WIN32)
+        m_base = VirtualAlloc(nullptr, m_reserved, MEM_RESERVE, PAGE_NOACCESS);
+#else
+        m_base = mmap(nullptr, m_reserved, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        if(m_base == MAP_FAILED)
+        {
+            m_base = nullptr;
+        }
+#endif
+
+        assert(m_base && "Column arena reserve failed!");
+    }
+
+    void ColumnArena::Commit(uint64_t size)
+    {
+        if(size <= m_committed)
+        {
+            return;
+        }
+
+        uint64_t newCommitted = std::max<uint64_t>(m_committed * 2, ColumnArenaPageSize);
+
+        while(newCommitted < size)
+        {
+            newCommitted *= 2;
+        }
+
+        newCommitted = std::min<uint64_t>(newCommitted, m_reserved);
+        assert(size <= newCommitted && "Column arena is out of reserved memory!");
+
+        void* growStart = OFFSET(m_base, m_committed);
+        uint64_t growSize = newCommitted - m_committed;
+
+#if defined(_WIN32)
+        void* r = VirtualAlloc(growStart, growSize, MEM_COMMIT, PAGE_READWRITE);
+        assert(r && "Column arena commit failed!");
+        (void)r;
+#else
+        int32_t r = mprotect(growStart, growSize, PROT_READ | PROT_WRITE);
+        assert(r == 0 && "Column arena commit failed!");
+        (void)r;
+
+#if defined(MADV_HUGEPAGE)
+        //small columns stay on 4 KB pages, a huge page would mostly be unused
+        if(newCommitted >= HugePageSize)
+        {
+            uintptr_t start = RCAST(m_base, uintptr_t);
+            uintptr_t hugeStart = (start + HugePageSize - 1) & ~(HugePageSize - 1);
+            uintptr_t hugeEnd = (start + newCommitted) & ~(HugePageSize - 1);
+
+            if(hugeEnd > hugeStart)
+            {
+                madvise(RCAST(hugeStart, void*), hugeEnd - hugeStart, MADV_HUGEPAGE);
+            }
+        }
+#endif
+#endif
+
+        m_committed = newCommitted;
+    }
+
+    void ColumnArena::Destroy()
+    {
+        if(!m_base)
+        {
+            return;
+        }
+
+#if defined(_WIN32)
+        VirtualFree(m_base, 0, MEM_RELEASE);
+#else
+        munmap(m_base, m_reserved);
+#endif
+
+        m_base = nullptr;
+        m_reserved = 0;
+        m_committed = 0;
+    }
+}
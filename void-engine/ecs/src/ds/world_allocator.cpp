@@ -1,40 +1,176 @@
 #include "ds/world_allocator.h"
+#include "job_system.h"
 
 namespace ECS
 {
     void WorldAllocator::Init()
     {
-        m_chunks.Init(SparsePageCount * sizeof(BlockAllocator));   
+        m_chunks.Init(SparsePageCount * sizeof(BlockAllocator));
         m_sparse.Init(nullptr, &m_chunks, WorldAllocDefaultDense, false);
+
+        //created up front, workers only read the sparse set
+        for(uint32_t classIdx = 0; classIdx < CachedClassCount; classIdx++)
+        {
+            m_classes[classIdx] = GetOrCreateBalloc(CachedMinSize << classIdx);
+        }
+
+        m_threadCaches = nullptr;
+        m_threadCount = 0;
+        SetThreadCount(1);
+    }
+
+    void WorldAllocator::Destroy()
+    {
+        DestroyThreadCaches();
+
+        for(uint32_t bIdx = 1; bIdx <= m_sparse.GetCount(); bIdx++)
+        {
+            BlockAllocator* ba = m_sparse.GetPageData(m_sparse.GetId(bIdx));
+            assert(ba);
+
+            ba->Destroy();
+        }
+
+        m_sparse.Destroy();
+        m_chunks.Destroy();
+    }
+
+    void WorldAllocator::SetThreadCount(uint32_t threadCount)
+    {
+        assert(threadCount && "Thread count is 0!");
+
+        DestroyThreadCaches();
+
+        m_threadCaches = new AllocatorThreadCache[threadCount];
+        m_threadCount = threadCount;
+
+        for(uint32_t tIdx = 0; tIdx < threadCount; tIdx++)
+        {
+            for(uint32_t classIdx = 0; classIdx < CachedClassCount; classIdx++)
+            {
+                m_threadCaches[tIdx].magazines[classIdx].count = 0;
+            }
+        }
+    }
+
+    void WorldAllocator::DestroyThreadCaches()
+    {
+        if(!m_threadCaches)
+        {
+            return;
+        }
+
+        for(uint32_t tIdx = 0; tIdx < m_threadCount; tIdx++)
+        {
+            for(uint32_t classIdx = 0; classIdx < CachedClassCount; classIdx++)
+            {
+                AllocatorMagazine& magazine = m_threadCaches[tIdx].magazines[classIdx];
+                Return(classIdx, magazine, magazine.count);
+            }
+        }
+
+        delete[] m_threadCaches;
+        m_threadCaches = nullptr;
+        m_threadCount = 0;
+    }
+
+    void WorldAllocator::Refill(uint32_t classIdx, AllocatorMagazine& magazine)
+    {
+        std::lock_guard<std::mutex> lock(m_classLocks[classIdx]);
+
+        BlockAllocator* block = m_classes[classIdx];
+
+        for(uint32_t i = 0; i < MagazineBatch; i++)
+        {
+            magazine.chunks[magazine.count++] = block->Alloc();
+        }
+    }
+
+    void WorldAllocator::Return(uint32_t classIdx, AllocatorMagazine& magazine, uint32_t count)
+    {
+        if(count == 0)
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_classLocks[classIdx]);
+
+        BlockAllocator* block = m_classes[classIdx];
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            //chunks freed by another thread still go back to the class that owns their block
+            block->Free(magazine.chunks[--magazine.count]);
+        }
+    }
+
+    void* WorldAllocator::CacheAlloc(uint32_t alignedSize)
+    {
+        if(alignedSize > CachedMaxSize)
+        {
+            return AlignedAlloc(alignedSize, MaxChunkAlign);
+        }
+
+        uint32_t threadIdx = JobSystem::GetThreadIndex();
+        assert(threadIdx < m_threadCount && "Thread has no allocator cache!");
+
+        uint32_t classIdx = CountTrailingZeros64(alignedSize / CachedMinSize);
+        AllocatorMagazine& magazine = m_threadCaches[threadIdx].magazines[classIdx];
+
+        if(magazine.count == 0)
+        {
+            Refill(classIdx, magazine);
+        }
+
+        return magazine.chunks[--magazine.count];
+    }
+
+    void WorldAllocator::CacheFree(uint32_t alignedSize, void* addr)
+    {
+        if(alignedSize > CachedMaxSize)
+        {
+            AlignedFree(addr);
+            return;
+        }
+
+        uint32_t threadIdx = JobSystem::GetThreadIndex();
+        assert(threadIdx < m_threadCount && "Thread has no allocator cache!");
+
+        uint32_t classIdx = CountTrailingZeros64(alignedSize / CachedMinSize);
+        AllocatorMagazine& magazine = m_threadCaches[threadIdx].magazines[classIdx];
+
+        if(magazine.count == MagazineCapacity)
+        {
+            Return(classIdx, magazine, MagazineBatch);
+        }
+
+        magazine.chunks[magazine.count++] = addr;
     }
 
     void* WorldAllocator::Alloc(uint32_t size)
     {
         uint32_t alignedSize = RoundMinPowerOf2(size, 16);
 
-        BlockAllocator* block = GetOrCreateBalloc(alignedSize);
-
-        return block->Alloc();
+        return CacheAlloc(alignedSize);
     }
 
     void* WorldAllocator::Calloc(uint32_t size)
     {
         uint32_t alignedSize = RoundMinPowerOf2(size, 16);
 
-        BlockAllocator* block = GetOrCreateBalloc(alignedSize);    
+        void* addr = CacheAlloc(alignedSize);
+        std::memset(addr, 0, alignedSize);
 
-        return block->Calloc();
+        return addr;
     }
-    
+
     void WorldAllocator::Free(uint32_t size, void* addr)
     {
         uint32_t alignedSize = RoundMinPowerOf2(size, 16);
 
-        BlockAllocator* block = GetOrCreateBalloc(alignedSize);    
-
-        block->Free(addr);
+        CacheFree(alignedSize, addr);
     }
-    
+
     BlockAllocator* WorldAllocator::GetOrCreateBalloc(uint32_t size)
     {
         //pack the size into closer
@@ -71,12 +207,11 @@ namespace ECS
 
         expandedCapacity = alignedSize / elementSize;
 
-        BlockAllocator* block = GetOrCreateBalloc(alignedSize);
-
-        std::cout << "Alloc " << elementSize * capacity << " using block allocator with chunk size: " 
-            << block->m_chunkSize << ", chunk count: " << block->m_chunkCount << std::endl;
+#ifdef ECS_TRACE_ALLOC
+        std::cout << "Alloc " << elementSize * capacity << " using size class: " << alignedSize << std::endl;
+#endif
 
-        return block->Alloc();
+        return CacheAlloc(alignedSize);
     }
 
     void* WorldAllocator::CallocN(uint32_t elementSize, uint32_t capacity, uint32_t& expandedCapacity)
@@ -87,12 +222,14 @@ namespace ECS
 
         expandedCapacity = alignedSize / elementSize;
 
-        BlockAllocator* block = GetOrCreateBalloc(alignedSize);
+#ifdef ECS_TRACE_ALLOC
+        std::cout << "Calloc " << elementSize * capacity << " using size class: " << alignedSize << std::endl;
+#endif
 
-        std::cout << "Calloc " << elementSize * capacity << " using block allocator with chunk size: " 
-            << block->m_chunkSize << ", chunk count: " << block->m_chunkCount << std::endl;
+        void* addr = CacheAlloc(alignedSize);
+        std::memset(addr, 0, alignedSize);
 
-        return block->Calloc();
+        return addr;
     }
 
-}
\ No newline at end of file
+}
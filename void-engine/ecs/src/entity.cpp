@@ -23,6 +23,16 @@ namespace ECS
         m_world->RemoveComponent(m_id, cId);
     }
 
+    void EntityMutator::AddToggleImpl(EntityId cId)
+    {
+        m_world->AddToggle(m_id, cId);
+    }
+
+    void EntityMutator::SetEnabledImpl(EntityId cId, bool isEnabled)
+    {
+        m_world->SetEnabled(m_id, cId, isEnabled);
+    }
+
     void* EntityMutator::GetImpl(EntityId cId)
     {
         return m_world->Get(m_id, cId);
@@ -0,0 +1,227 @@
+#include "job_system.h"
+
+namespace ECS
+{
+    static thread_local uint32_t t_threadIndex = 0;
+
+    void JobDeque::Init()
+    {
+        m_jobs = PTR_CAST(std::malloc(sizeof(Job) * JobDequeCapacity), Job);
+        assert(m_jobs && "Job deque is null!");
+
+        m_head = 0;
+        m_tail = 0;
+    }
+
+    void JobDeque::Destroy()
+    {
+        std::free(m_jobs);
+        m_jobs = nullptr;
+    }
+
+    bool JobDeque::Push(const Job& job)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if(m_tail - m_head == JobDequeCapacity)
+        {
+            return false;
+        }
+
+        m_jobs[m_tail & (JobDequeCapacity - 1)] = job;
+        ++m_tail;
+
+        return true;
+    }
+
+    bool JobDeque::Pop(Job& job)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if(m_tail == m_head)
+        {
+            return false;
+        }
+
+        --m_tail;
+        job = m_jobs[m_tail & (JobDequeCapacity - 1)];
+
+        return true;
+    }
+
+    bool JobDeque::Steal(Job& job)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex, std::try_to_lock);
+
+        if(!lock.owns_lock() || m_tail == m_head)
+        {
+            return false;
+        }
+
+        job = m_jobs[m_head & (JobDequeCapacity - 1)];
+        ++m_head;
+
+        return true;
+    }
+
+    void JobSystem::Init(uint32_t workerCount)
+    {
+        m_workerCount = workerCount;
+        m_pendingJobs = 0;
+        m_running = true;
+
+        m_deques = new JobDeque[GetThreadCount()];
+
+        for(uint32_t idx = 0; idx < GetThreadCount(); idx++)
+        {
+            m_deques[idx].Init();
+        }
+
+        m_workers = PTR_CAST(std::malloc(sizeof(std::thread) * (m_workerCount + 1)), std::thread);
+
+        for(uint32_t idx = 0; idx < m_workerCount; idx++)
+        {
+            new (&m_workers[idx]) std::thread(&JobSystem::WorkerLoop, this, idx + 1);
+        }
+    }
+
+    void JobSystem::Destroy()
+    {
+        if(!m_deques)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_running = false;
+        }
+        m_wake.notify_all();
+
+        for(uint32_t idx = 0; idx < m_workerCount; idx++)
+        {
+            m_workers[idx].join();
+            m_workers[idx].~thread();
+        }
+
+        for(uint32_t idx = 0; idx < GetThreadCount(); idx++)
+        {
+            m_deques[idx].Destroy();
+        }
+
+        std::free(m_workers);
+        delete[] m_deques;
+
+        m_workers = nullptr;
+        m_deques = nullptr;
+        m_workerCount = 0;
+    }
+
+    uint32_t JobSystem::GetThreadIndex()
+    {
+        return t_threadIndex;
+    }
+
+    void JobSystem::Schedule(const Job* jobs, uint32_t count)
+    {
+        uint32_t threadIndex = GetThreadIndex();
+
+        assert(threadIndex < GetThreadCount());
+
+        for(uint32_t idx = 0; idx < count; idx++)
+        {
+            m_pendingJobs.fetch_add(1);
+
+            if(!m_deques[threadIndex].Push(jobs[idx]))
+            {
+                //deque is full, run it right away
+                m_pendingJobs.fetch_sub(1);
+                RunJob(jobs[idx]);
+            }
+        }
+
+        //take the lock so a worker can not miss the wake up between its check and its wait
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+        }
+        m_wake.notify_all();
+    }
+
+    void JobSystem::Wait(std::atomic<uint32_t>& counter)
+    {
+        uint32_t threadIndex = GetThreadIndex();
+
+        while(counter.load() != 0)
+        {
+            if(!TryRunJob(threadIndex))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool JobSystem::TryRunJob(uint32_t threadIndex)
+    {
+        Job job;
+
+        if(!m_deques[threadIndex].Pop(job))
+        {
+            bool stolen = false;
+
+            for(uint32_t offset = 1; offset < GetThreadCount(); offset++)
+            {
+                if(m_deques[(threadIndex + offset) % GetThreadCount()].Steal(job))
+                {
+                    stolen = true;
+                    break;
+                }
+            }
+
+            if(!stolen)
+            {
+                return false;
+            }
+        }
+
+        m_pendingJobs.fetch_sub(1);
+        RunJob(job);
+
+        return true;
+    }
+
+    void JobSystem::RunJob(const Job& job)
+    {
+        job.func(job.data);
+
+        if(job.counter)
+        {
+            job.counter->fetch_sub(1);
+        }
+    }
+
+    void JobSystem::WorkerLoop(uint32_t threadIndex)
+    {
+        t_threadIndex = threadIndex;
+
+        while(true)
+        {
+            if(TryRunJob(threadIndex))
+            {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+
+            m_wake.wait(lock, [this]()
+                {
+                    return !m_running || m_pendingJobs.load() > 0;
+                }
+            );
+
+            if(!m_running)
+            {
+                break;
+            }
+        }
+    }
+}
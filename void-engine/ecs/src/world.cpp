@@ -22,19 +22,87 @@ namespace ECS
         m_wAllocator.Init();
         InitAllocators();
         m_entityIndex.Init(&m_wAllocator, nullptr, 8, true);
+        m_denseIndices.Init(&m_wAllocator, nullptr, 8, false);
+        m_sparseStorages.Init(&m_wAllocator, nullptr, 8, false);
         m_archetypes.Init(&m_wAllocator, &m_allocators.archetypes, 8, false);
         m_componentIndex.Init(&m_wAllocator, 8);
         m_typeInfos.Init(&m_wAllocator, 8);
         m_mappedArchetype.Init(&m_wAllocator, 8);
 
         m_systemStore.Init(m_wAllocator);
-        m_componentStore.Init(m_wAllocator);
+        m_schedule.Init(m_wAllocator);
+        m_scheduleStages.Init(m_wAllocator);
+        m_queryStore.Init(m_wAllocator);
+        m_queryCache.Init(&m_wAllocator, 8);
+        m_mergedCommands.Init(m_wAllocator);
+        m_eventBuffers.Init(m_wAllocator);
+        m_flushedEvents.Init(m_wAllocator);
+        m_queryEventBuffers.Init(m_wAllocator);
+        m_destroyQueue.Init(m_wAllocator);
+        m_deferredDestroys.Init(m_wAllocator);
+        m_droppedPairs.Init(m_wAllocator);
+
+        for(uint32_t type = 0; type < EventTypeCount; type++)
+        {
+            m_eventBufferIndex[type].Init(&m_wAllocator, 8);
+        }
+
         m_isDefered = false;
+
+        m_jobSystem.Init(0);
+        InitCommandBuffers();
+    }
+
+    void World::SetWorkerCount(uint32_t count)
+    {
+        assert(!m_isDefered && "Can not change workers while progressing!");
+
+        DestroyCommandBuffers();
+        m_jobSystem.Destroy();
+        m_jobSystem.Init(count);
+        m_wAllocator.SetThreadCount(m_jobSystem.GetThreadCount());
+        InitCommandBuffers();
+    }
+
+    void World::InitCommandBuffers()
+    {
+        m_commandBufferCount = m_jobSystem.GetThreadCount();
+        m_commandBuffers =
+            PTR_CAST(m_wAllocator.Alloc(sizeof(CommandBuffer) * m_commandBufferCount), CommandBuffer);
+
+        for(uint32_t i = 0; i < m_commandBufferCount; i++)
+        {
+            new (&m_commandBuffers[i]) CommandBuffer();
+            m_commandBuffers[i].Init();
+        }
+    }
+
+    void World::DestroyCommandBuffers()
+    {
+        for(uint32_t i = 0; i < m_commandBufferCount; i++)
+        {
+            assert(m_commandBuffers[i].GetCount() == 0 && "Unmerged commands!");
+            m_commandBuffers[i].Destroy();
+        }
+
+        m_wAllocator.Free(sizeof(CommandBuffer) * m_commandBufferCount, m_commandBuffers);
+        m_commandBuffers = nullptr;
+        m_commandBufferCount = 0;
+    }
+
+    CommandBuffer& World::GetCommandBuffer()
+    {
+        uint32_t threadIdx = JobSystem::GetThreadIndex();
+
+        assert(threadIdx < m_commandBufferCount);
+
+        return m_commandBuffers[threadIdx];
     }
 
     void World::InitAllocators()
     {
         m_allocators.archetypes.Init(SparsePageCount * sizeof(Archetype));
+        m_allocators.chunks.Init(ArchetypeChunkSize, ArchetypeChunksPerBlock);
     }
 
     void World::RegisterInternalComponents()
@@ -45,6 +113,7 @@ namespace ECS
         Tag<EcsPhase>().Id(EcsPhaseId).Register();
         Tag<EcsArchetype>().Id(EcsArchetypeId).Register();
         Tag<EcsPipeline>().Id(EcsPipelineId).Register();
+        Tag<Wildcard>().Id(WildcardId).Register();
 
         Pair<ChildOf>(true).Id(ChildOfId).Register();
         Pair<DependOn>(false).Id(DependOnId).Register();
@@ -73,19 +142,18 @@ namespace ECS
 
     Entity World::CreateEntity(EntityId id, const char* name, EntityId parent)
     {
-        bool newId = false;
-        if(!m_entityIndex.isValidDense(id))
+        if(m_isDefered)
         {
-            newId = true;
+            return Entity(DeferCreateEntity(id, name, parent), this);
         }
-        else
+
+        //an explicit dead id is revived in place
+        if(id == 0 || m_entityIndex.Contains(id))
         {
-            auto pair = GetId();
-            id = pair.second;
-            newId = pair.first;
+            id = GetId().second;
         }
 
-        uint32_t dense = m_entityIndex.PushBack(id, EntityRecord{}, newId);
+        uint32_t dense = m_entityIndex.PushBack(id, EntityRecord{});
         EntityRecord& r = *m_entityIndex.GetPageData(id);
         r.dense = dense;
 
@@ -100,11 +168,213 @@ namespace ECS
         return Entity(id, this);
     }
 
+    EntityId World::CreateEntities(uint32_t count, const ComponentSet& componentSet, const void* const* values)
+    {
+        assert(!m_isDefered && "Can not bulk create while progressing!");
+        assert(count);
+
+#ifdef ECS_DEBUG
+        for(uint32_t i = 0; i < componentSet.count; i++)
+        {
+            assert(!GetSparseStorage(componentSet.idArr[i]) && "Sparse components are added per entity!");
+        }
+#endif
+
+        Archetype* archetype = nullptr;
+
+        if(componentSet.count)
+        {
+            archetype = GetArchetype(componentSet);
+
+            if(!archetype)
+            {
+                //the archetype keeps its own copy of the set
+                ComponentSet cs;
+                cs.Alloc(m_wAllocator, componentSet.count);
+                cs.count = componentSet.count;
+                std::memcpy(cs.idArr, componentSet.idArr, sizeof(EntityId) * cs.count);
+
+                archetype = CreateArchetype(std::move(cs));
+            }
+        }
+
+        EntityId firstId = GetFreeIdRange(count);
+        m_entityIndex.Reserve(count);
+
+        if(!archetype)
+        {
+            for(uint32_t i = 0; i < count; i++)
+            {
+                EntityId id = firstId + i;
+                uint32_t dense = m_entityIndex.PushBack(id, EntityRecord{});
+                m_entityIndex.GetPageData(id)->dense = dense;
+            }
+
+            return firstId;
+        }
+
+        uint32_t firstRow = archetype->count;
+        uint32_t lastRow = firstRow + count;
+
+        ReserveArchetype(*archetype, count);
+
+        //walk chunk spans, every span is contiguous inside its column
+        for(uint32_t row = firstRow; row < lastRow;)
+        {
+            uint32_t chunkIdx = archetype->GetChunkIndex(row);
+            uint32_t chunkRow = archetype->GetChunkRow(row);
+            uint32_t spanCount = std::min(archetype->GetChunkCapacity() - chunkRow, lastRow - row);
+
+            EntityId* entities = archetype->GetChunkEntities(chunkIdx) + chunkRow;
+
+            for(uint32_t i = 0; i < spanCount; i++)
+            {
+                entities[i] = firstId + (row - firstRow) + i;
+            }
+
+            for(uint32_t i = 0; i < archetype->components.count; i++)
+            {
+                int32_t colIdx = archetype->componentMap[i];
+
+                if(colIdx == -1)
+                {
+                    continue;
+                }
+
+                TypeInfo& ti = *archetype->columns[colIdx].typeInfo;
+                const void* value = values ? values[i] : nullptr;
+
+                if(ti.IsSoa())
+                {
+                    for(uint32_t r = 0; r < spanCount && value; r++)
+                    {
+                        WriteSoaRow(*archetype, colIdx, row + r, value);
+                    }
+
+                    if(!value)
+                    {
+                        ConstructColumnRows(*archetype, colIdx, row, spanCount);
+                    }
+
+                    continue;
+                }
+
+                uint8_t* dest = PTR_CAST(archetype->GetChunkColumn(chunkIdx, colIdx), uint8_t) + chunkRow * ti.size;
+
+                if(value && ti.hook.copyCtor)
+                {
+                    for(uint32_t r = 0; r < spanCount; r++)
+                    {
+                        ti.hook.copyCtor(dest + r * ti.size, value);
+                    }
+                }
+                else if(value)
+                {
+                    //copy the first row then double the filled range
+                    std::memcpy(dest, value, ti.size);
+
+                    for(uint32_t filled = 1; filled < spanCount;)
+                    {
+                        uint32_t copyCount = std::min(filled, spanCount - filled);
+                        std::memcpy(dest + filled * ti.size, dest, copyCount * ti.size);
+                        filled += copyCount;
+                    }
+                }
+                else if(ti.hook.ctor)
+                {
+                    for(uint32_t r = 0; r < spanCount; r++)
+                    {
+                        ti.hook.ctor(dest + r * ti.size);
+                    }
+                }
+            }
+
+            //toggled components start enabled
+            for(uint32_t r = 0; r < spanCount && archetype->toggleCount; r++)
+            {
+                MoveToggleBits(*archetype, row + r, nullptr, 0);
+            }
+
+            MarkChunkChanged(*archetype, chunkIdx);
+
+            row += spanCount;
+        }
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            EntityId id = firstId + i;
+
+            EntityRecord record;
+            record.archetype = archetype;
+            record.row = firstRow + i;
+            record.dense = 0;
+
+            uint32_t dense = m_entityIndex.PushBack(id, record);
+            m_entityIndex.GetPageData(id)->dense = dense;
+        }
+
+        archetype->count = lastRow;
+
+        for(uint32_t i = 0; i < archetype->components.count; i++)
+        {
+            EntityId cId = archetype->components.idArr[i];
+
+            if(LO_ENTITY_ID(cId) == DependOnId && HI_ENTITY_ID(cId) != 0)
+            {
+                m_isScheduleDirty = true;
+            }
+
+            EmitRows(EventType::OnAdd, cId, *archetype, firstRow, count);
+        }
+
+        return firstId;
+    }
+
+    EntityId World::DeferCreateEntity(EntityId id, const char* name, EntityId parent)
+    {
+        //only fresh ids while deferred, reused ids need the dense array
+        if(id == 0 || m_entityIndex.Contains(id))
+        {
+            do
+            {
+                id = m_deferredNextId.fetch_add(1, std::memory_order_relaxed) + 1;
+            } while(m_entityIndex.Contains(id));
+        }
+
+        CommandBuffer& cb = GetCommandBuffer();
+        cb.Push(CommandType::CreateEntity, id, 0);
+
+        if(parent != 0)
+        {
+            cb.Push(CommandType::AddComponent, id, MakePair(ComponentTypeId<ChildOf>::id, parent));
+        }
+
+        if(name)
+        {
+            EcsName* ecsName = new (cb.PushData(sizeof(EcsName), alignof(EcsName))) EcsName();
+            std::snprintf(ecsName->name, 16, "%s", name);
+
+            cb.Push(CommandType::AddComponent, id, EcsNameId);
+            cb.Push(CommandType::Set, id, EcsNameId, ecsName);
+        }
+
+        return id;
+    }
+
     EntityId World::GetNextFreeId()
     {
-        while(m_entityIndex.isValidDense(++m_nextFreeId));
+        return GetFreeIdRange(1);
+    }
+
+    EntityId World::GetFreeIdRange(uint32_t count)
+    {
+        //explicit ids above the counter are skipped at once, ids past the max were never used
+        m_nextFreeId = std::max(m_nextFreeId, m_entityIndex.GetMaxId());
 
-        return m_nextFreeId;
+        EntityId firstId = m_nextFreeId + 1;
+        m_nextFreeId += count;
+
+        return firstId;
     }
 
     EntityId World::GetReusedId()
@@ -126,7 +396,7 @@ namespace ECS
         }
         else
         {
-            INCRE_GEN_COUNT(id);
+            id = INCRE_GEN_COUNT(id);
         }
 
         return {newId, id};
@@ -134,10 +404,7 @@ namespace ECS
 
     Entity World::GetEntity(EntityId eId)
     {
-        EntityRecord* r = m_entityIndex.GetPageData(eId);
-        uint32_t dense = r->dense;
-        uint64_t versionedId = m_entityIndex.GetDenseArr()[dense];
-        if(!r || versionedId != eId)
+        if(!IsAlive(eId))
         {
             return Entity(0, this);
         }
@@ -145,880 +412,3554 @@ namespace ECS
         return Entity(eId, this);
     }
 
-    Entity World::CreateEntity(EntityDesc& desc)
+    bool World::IsAlive(EntityId eId)
     {
-        if(!m_entityIndex.isValidDense(desc.id))
-        {
-            Entity e(desc.id, this);
-
-            EntityRecord r;
-            r.archetype = nullptr;
-            r.dense = 0;
-            r.row = 0;
-            //std::snprintf(r.name, 16, desc.name);
+        return m_entityIndex.IsAlive(eId);
+    }
 
-            r.dense = m_entityIndex.PushBack(e.GetFullId(), r, true);
-            EntityRecord& er = *GetEntityRecord(e.GetFullId());
-            er.dense = r.dense;
+    void World::DestroyEntity(EntityId eId)
+    {
+        DestroyEntities(&eId, 1);
+    }
 
-            ResolveEntityDesc(er, desc);
+    struct DestroyVictim
+    {
+        Archetype* archetype;
+        uint32_t row;
+        EntityId id;
+    };
 
-            return e;
-        }
-        else
+    void World::DestroyEntities(const EntityId* ids, uint32_t count, bool isReparent)
+    {
+        if(m_isDefered)
         {
-            uint64_t freeId = m_entityIndex.GetReusedId();
-            bool newId = false;
-            if(freeId == 0)
+            CommandBuffer& cb = GetCommandBuffer();
+
+            for(uint32_t i = 0; i < count; i++)
             {
-                newId = true;
+                cb.Push(CommandType::DestroyEntity, ids[i], 0);
+            }
 
-                while(m_entityIndex.isValidDense(++m_nextFreeId));
+            return;
+        }
 
-                freeId = m_nextFreeId;
-            }
-            Entity e(freeId, this);
+        m_destroyQueue.count = 0;
 
-            if(!newId)
+        for(uint32_t i = 0; i < count; i++)
+        {
+            if(!IsAlive(ids[i]))
             {
-                e.IncreGenCount();
+                continue;
             }
 
-            EntityRecord r;
-            r.archetype = nullptr;
-            r.dense = 0;
-            r.row = 0;
-            //std::snprintf(r.name, 16, desc.name);
-
-            r.dense = m_entityIndex.PushBack(e.GetFullId(), r, newId);
-            EntityRecord& er = *GetEntityRecord(e.GetFullId());
-            er.dense = r.dense;
-
-            ResolveEntityDesc(er, desc);
+            if(m_destroyQueue.count == m_destroyQueue.capacity)
+            {
+                m_destroyQueue.Grow(m_wAllocator);
+            }
 
-            return e;
+            m_destroyQueue.Add(ids[i]);
         }
-    }
-
-    EntityRecord* World::GetEntityRecord(EntityId eId)
-    {
-        EntityRecord* e = m_entityIndex.GetPageData(eId);
 
-        if(!e)
-        {
-            return nullptr;
-        }
-        else
+        //children go up to the parent of the victim, read when it is reached, so a
+        //child of a chain of victims ends under the first survivor
+        for(uint32_t vIdx = 0; vIdx < m_destroyQueue.count && isReparent; vIdx++)
         {
-            return e;
+            ReparentChildren(m_destroyQueue.store[vIdx]);
         }
-    }
 
-    void World::ResolveEntityDesc(EntityRecord& r, EntityDesc& desc)
-    {
-        ComponentSet cs;
-        Archetype* destArchetype = r.archetype;
-        if(desc.parent != 0)
+        //children are destroyed with their parent, the queue grows while it is walked
+        for(uint32_t vIdx = 0; vIdx < m_destroyQueue.count && !isReparent; vIdx++)
         {
-            if(!m_componentIndex.ContainsKey(MakePair(ComponentTypeId<ChildOf>::id, desc.parent)))
+            ComponentRecord* cr = m_componentIndex.TryGetValue(MakePair(ChildOfId, m_destroyQueue.store[vIdx]));
+
+            for(uint32_t aIdx = 0; cr && aIdx < cr->archetypeStore.count; aIdx++)
             {
-                TypeInfo* ti = new (m_wAllocator.Alloc(sizeof(TypeInfo))) TypeInfo();
-                *ti = *(m_typeInfos[ComponentTypeId<ChildOf>::id]);
-                ti->flags |= FULL_PAIR;
-                ti->id = MakePair(ComponentTypeId<ChildOf>::id, desc.parent);
+                Archetype* archetype = cr->archetypeStore.store[aIdx];
 
-                TypeInfoBuilder<> builder{*ti, this};
-                char name[30];
-                std::snprintf(name, 30, "ChildOf %u", LO_ENTITY_ID(desc.parent));
-                builder.Register(name);
+                for(uint32_t row = 0; row < archetype->count; row++)
+                {
+                    if(m_destroyQueue.count == m_destroyQueue.capacity)
+                    {
+                        m_destroyQueue.Grow(m_wAllocator);
+                    }
+
+                    m_destroyQueue.Add(archetype->GetEntity(row));
+                }
             }
+        }
 
-            destArchetype = GetOrCreateArchetype_Add(destArchetype, MakePair(ComponentTypeId<ChildOf>::id, desc.parent));
+        uint32_t victimCount = m_destroyQueue.count;
+
+        if(victimCount == 0)
+        {
+            return;
         }
-        if(desc.name)
+
+        DestroyVictim* victims = PTR_CAST(m_wAllocator.Alloc(sizeof(DestroyVictim) * victimCount), DestroyVictim);
+
+        for(uint32_t vIdx = 0; vIdx < victimCount; vIdx++)
         {
-            destArchetype = GetOrCreateArchetype_Add(destArchetype, ComponentTypeId<EcsName>::id);
+            EntityRecord* r = m_entityIndex.GetPageData(m_destroyQueue.store[vIdx]);
+
+            victims[vIdx] = DestroyVictim{r->archetype, r->row, m_destroyQueue.store[vIdx]};
         }
 
-        if(destArchetype)
+        //grouped by table, back rows first so the rows filling the holes are never victims
+        std::sort(victims, victims + victimCount,
+                  [](const DestroyVictim& a, const DestroyVictim& b)
+                  {
+                      return a.archetype != b.archetype ? a.archetype < b.archetype : a.row > b.row;
+                  });
+
+        for(uint32_t vIdx = 0; vIdx < victimCount; vIdx++)
         {
-            if(destArchetype->count == destArchetype->capacity)
+            DestroyVictim& victim = victims[vIdx];
+            Archetype* archetype = victim.archetype;
+
+            //listed twice, by the caller and as a child
+            if((vIdx > 0 && victims[vIdx - 1].id == victim.id) || !archetype)
             {
-                GrowArchetype(*destArchetype);
+                continue;
             }
 
-            for(uint32_t i = 0; i < destArchetype->components.count; i++)
+            for(uint32_t i = 0; i < archetype->components.count; i++)
             {
-                //skip no data tag and pair
-                int32_t destColIdx = destArchetype->componentMap[i];
+                EntityId cId = archetype->components.idArr[i];
 
-                if(destColIdx == -1)
+                if(LO_ENTITY_ID(cId) == DependOnId && HI_ENTITY_ID(cId) != 0)
                 {
-                    continue;
+                    m_isScheduleDirty = true;
                 }
 
-                Column& destCol = destArchetype->columns[destColIdx];
-                TypeInfo& ti = *destCol.typeInfo;
+                Emit(EventType::OnRemove, cId, victim.id, archetype);
+            }
 
-                void* dest = OFFSET(destCol.data, ti.size * destArchetype->count);
+            for(uint32_t colIdx = 0; colIdx < archetype->columnCount; colIdx++)
+            {
+                TypeInfo& ti = *archetype->columns[colIdx].typeInfo;
 
-                if(destArchetype->components.idArr[i] == EcsNameId && desc.name)
+                if(ti.hook.dtor)
                 {
-                    EcsName name;
-                    std::snprintf(name.name, 16, desc.name);
-                    ti.hook.moveCtor(dest, &name);
+                    ti.hook.dtor(archetype->GetColumnData(colIdx, victim.row));
                 }
             }
 
-            destArchetype->entities[destArchetype->count] = desc.id;
-            r.archetype = destArchetype;
-            r.row = destArchetype->count;
-            ++destArchetype->count;
+            RemoveRow(*archetype, victim.row);
         }
-    }
 
-    void World::AddComponent(EntityId eId, EntityId cId)
-    {
-        EntityRecord* r = m_entityIndex.GetPageData(eId);
-        TypeInfo* cTi = m_typeInfos[cId];
+        for(uint32_t sIdx = 1; sIdx <= m_sparseStorages.GetCount(); sIdx++)
+        {
+            SparseStorage* storage = *m_sparseStorages.GetPageData(m_sparseStorages.GetId(sIdx));
 
-        assert(r);
+            for(uint32_t vIdx = 0; vIdx < victimCount && storage->GetCount(); vIdx++)
+            {
+                if(storage->Has(victims[vIdx].id))
+                {
+                    Emit(EventType::OnRemove, storage->typeInfo->id, victims[vIdx].id, victims[vIdx].archetype);
+                    RemoveSparse(*storage, victims[vIdx].id);
+                }
+            }
+        }
 
-        if(r->archetype)
+        //the ids are the next ones GetId reuses, with a new generation
+        for(uint32_t vIdx = 0; vIdx < victimCount; vIdx++)
         {
-            int32_t s = r->archetype->components.Search(cId);
+            m_entityIndex.Remove(victims[vIdx].id);
+        }
 
-            assert(s == -1);
+        for(uint32_t vIdx = 0; vIdx < victimCount; vIdx++)
+        {
+            if(vIdx == 0 || victims[vIdx - 1].id != victims[vIdx].id)
+            {
+                DropTarget(victims[vIdx].id);
+            }
         }
 
-        Archetype* destArchetype = GetOrCreateArchetype_Add(r->archetype, cId);
+        m_wAllocator.Free(sizeof(DestroyVictim) * victimCount, victims);
+    }
 
-        MoveArchetype_Add(eId, *r, destArchetype);
+    void World::ReparentChildren(EntityId parent)
+    {
+        EntityRecord* r = m_entityIndex.GetPageData(parent);
+        int32_t childOfIdx = r->archetype ? r->archetype->components.SearchPair(ChildOfId) : -1;
+        EntityId grandParent = childOfIdx != -1 ? HI_ENTITY_ID(r->archetype->components.idArr[childOfIdx]) : 0;
+
+        EntityId oldPair = MakePair(ChildOfId, parent);
+        EntityId newPair = grandParent ? RegisterPair(ChildOfId, grandParent) : 0;
+
+        //archetypes may be created below, which can move the record in the component index
+        for(uint32_t aIdx = 0;; aIdx++)
+        {
+            ComponentRecord* cr = m_componentIndex.TryGetValue(oldPair);
+
+            if(!cr || aIdx >= cr->archetypeStore.count)
+            {
+                break;
+            }
+
+            Archetype* archetype = cr->archetypeStore.store[aIdx];
+            uint32_t rowCount = archetype->count;
+
+            if(rowCount == 0)
+            {
+                continue;
+            }
+
+            Archetype* destArchetype = GetOrCreateArchetype_Remove(archetype, oldPair);
+
+            if(newPair)
+            {
+                destArchetype = GetOrCreateArchetype_Add(destArchetype, newPair);
+            }
+
+            EmitRows(EventType::OnRemove, oldPair, *archetype, 0, rowCount);
+
+            uint32_t destFirst = destArchetype ? destArchetype->count : 0;
+
+            MoveArchetypeAll(archetype, destArchetype);
+
+            if(newPair)
+            {
+                EmitRows(EventType::OnAdd, newPair, *destArchetype, destFirst, rowCount);
+            }
+        }
+    }
+
+    void World::DropTarget(EntityId target)
+    {
+        EntityId tId = AnyRelation(target);
+
+        //survivors lose every pair to the target, archetypes may be created on the way
+        for(uint32_t aIdx = 0;; aIdx++)
+        {
+            ComponentRecord* tCr = m_componentIndex.TryGetValue(tId);
+
+            if(!tCr || aIdx >= tCr->archetypeStore.count)
+            {
+                break;
+            }
+
+            Archetype* archetype = tCr->archetypeStore.store[aIdx];
+
+            if(archetype->count == 0)
+            {
+                continue;
+            }
+
+            Archetype* destArchetype = archetype;
+
+            for(int32_t cIdx = archetype->components.SearchTarget(target);
+                cIdx != -1 && CAST(cIdx, uint32_t) < archetype->components.count &&
+                HI_ENTITY_ID(archetype->components.idArr[cIdx]) == LO_ENTITY_ID(target);
+                cIdx++)
+            {
+                EntityId pairId = archetype->components.idArr[cIdx];
+
+                if(LO_ENTITY_ID(pairId) == DependOnId)
+                {
+                    m_isScheduleDirty = true;
+                }
+
+                EmitRows(EventType::OnRemove, pairId, *archetype, 0, archetype->count);
+
+                destArchetype = GetOrCreateArchetype_Remove(destArchetype, pairId);
+
+                if(!destArchetype)
+                {
+                    break;
+                }
+            }
+
+            MoveArchetypeAll(archetype, destArchetype);
+        }
+
+        ComponentRecord* tCr = m_componentIndex.TryGetValue(tId);
+
+        if(!tCr)
+        {
+            return;
+        }
+
+        m_droppedPairs.count = 0;
+
+        //every archetype of the target is empty, deleting one removes it from the record
+        while(tCr->archetypeStore.count)
+        {
+            Archetype* archetype = tCr->archetypeStore.store[tCr->archetypeStore.count - 1];
+
+            for(int32_t cIdx = archetype->components.SearchTarget(target);
+                cIdx != -1 && CAST(cIdx, uint32_t) < archetype->components.count &&
+                HI_ENTITY_ID(archetype->components.idArr[cIdx]) == LO_ENTITY_ID(target);
+                cIdx++)
+            {
+                EntityId pairId = archetype->components.idArr[cIdx];
+
+                if(std::find(m_droppedPairs.store, m_droppedPairs.store + m_droppedPairs.count, pairId) ==
+                   m_droppedPairs.store + m_droppedPairs.count)
+                {
+                    if(m_droppedPairs.count == m_droppedPairs.capacity)
+                    {
+                        m_droppedPairs.Grow(m_wAllocator);
+                    }
+
+                    m_droppedPairs.Add(pairId);
+                }
+            }
+
+            DeleteArchetype(archetype);
+        }
+
+        //records are removed last, removing one can move the others
+        for(uint32_t pIdx = 0; pIdx < m_droppedPairs.count; pIdx++)
+        {
+            EntityId pairId = m_droppedPairs.store[pIdx];
+
+            m_componentIndex.GetValue(pairId).archetypeStore.Destroy(m_wAllocator);
+            m_componentIndex.Remove(pairId);
+
+            TypeInfo* ti = m_typeInfos.GetValue(pairId);
+            m_typeInfos.Remove(pairId);
+            m_wAllocator.Free(sizeof(TypeInfo), ti);
+        }
+
+        m_componentIndex.GetValue(tId).archetypeStore.Destroy(m_wAllocator);
+        m_componentIndex.Remove(tId);
+    }
+
+    static void RemoveArchetypeFromRecord(ComponentRecord& cr, Archetype* archetype)
+    {
+        for(uint32_t aIdx = 0; aIdx < cr.archetypeStore.count; aIdx++)
+        {
+            if(cr.archetypeStore.store[aIdx] == archetype)
+            {
+                cr.archetypeStore.store[aIdx] = cr.archetypeStore.store[cr.archetypeStore.count - 1];
+                --cr.archetypeStore.count;
+                return;
+            }
+        }
+    }
+
+    void World::DeleteArchetype(Archetype* archetype)
+    {
+        assert(archetype->count == 0 && "Only empty archetypes can be deleted!");
+
+        //edges are inserted with their reverse, so the neighbours are the archetype's own edges
+        for(auto it = archetype->addEdges.Begin(); it != archetype->addEdges.End(); ++it)
+        {
+            if(it.IsValid())
+            {
+                it.GetValue()->removeEdges.Remove(it.GetKey());
+            }
+        }
+
+        for(auto it = archetype->removeEdges.Begin(); it != archetype->removeEdges.End(); ++it)
+        {
+            if(it.IsValid())
+            {
+                it.GetValue()->addEdges.Remove(it.GetKey());
+            }
+        }
+
+        ComponentSet& components = archetype->components;
+
+        for(uint32_t idx = 0; idx < components.count; idx++)
+        {
+            EntityId cId = components.idArr[idx];
+
+            RemoveArchetypeFromRecord(m_componentIndex.GetValue(cId), archetype);
+
+            if(m_typeInfos.GetValue(cId)->IsFullPair())
+            {
+                RemoveArchetypeFromRecord(m_componentIndex.GetValue(LO_ENTITY_ID(cId)), archetype);
+
+                if(ComponentRecord* tCr = m_componentIndex.TryGetValue(AnyRelation(HI_ENTITY_ID(cId))))
+                {
+                    RemoveArchetypeFromRecord(*tCr, archetype);
+                }
+            }
+        }
+
+        //the last match fills the hole, cascade orders are sorted again
+        for(uint32_t qIdx = 0; qIdx < m_queryStore.count; qIdx++)
+        {
+            Query* query = m_queryStore.store[qIdx];
+            uint32_t termCount = query->terms.count;
+
+            for(uint32_t mIdx = 0; mIdx < query->archetypes.count; mIdx++)
+            {
+                if(query->archetypes.store[mIdx] != archetype)
+                {
+                    continue;
+                }
+
+                uint32_t lastIdx = query->archetypes.count - 1;
+
+                query->archetypes.store[mIdx] = query->archetypes.store[lastIdx];
+                std::memcpy(query->GetColumns(mIdx), query->GetColumns(lastIdx), sizeof(int32_t) * termCount);
+                std::memcpy(query->GetToggles(mIdx), query->GetToggles(lastIdx), sizeof(int32_t) * termCount);
+
+                --query->archetypes.count;
+                query->columns.count -= termCount;
+                query->toggles.count -= termCount;
+                break;
+            }
+        }
+
+        ++m_hierarchyVersion;
+
+        m_mappedArchetype.Remove(components);
+
+        FreeArchetype(*archetype);
+        m_archetypes.Remove(archetype->id);
+    }
+
+    void World::FreeArchetype(Archetype& archetype)
+    {
+        for(uint32_t chunkIdx = 0; chunkIdx < archetype.chunks.count; chunkIdx++)
+        {
+            FreeArchetypeChunk(archetype, archetype.chunks.store[chunkIdx].data);
+
+            if(archetype.chunks.store[chunkIdx].ticks)
+            {
+                m_wAllocator.Free(sizeof(uint32_t) * archetype.columnCount, archetype.chunks.store[chunkIdx].ticks);
+            }
+        }
+
+        archetype.chunks.Destroy(m_wAllocator);
+        m_wAllocator.Free(sizeof(int32_t) * archetype.components.count * 2, archetype.componentMap);
+
+        if(archetype.denseColumnMap)
+        {
+            m_wAllocator.Free(sizeof(int32_t) * archetype.denseColumnCount, archetype.denseColumnMap);
+        }
+
+        if(archetype.toggles)
+        {
+            m_wAllocator.Free(sizeof(ToggleColumn) * archetype.toggleCount, archetype.toggles);
+        }
+
+        m_wAllocator.Free(sizeof(Column) * archetype.components.count, archetype.columns);
+        archetype.components.Free(m_wAllocator);
+        archetype.addEdges.Destroy();
+        archetype.removeEdges.Destroy();
+    }
+
+    Entity World::CreateEntity(EntityDesc& desc)
+    {
+        if(m_isDefered)
+        {
+            return Entity(DeferCreateEntity(desc.id, desc.name, desc.parent), this);
+        }
+
+        if(!m_entityIndex.isValidDense(desc.id))
+        {
+            Entity e(desc.id, this);
+
+            EntityRecord r;
+            r.archetype = nullptr;
+            r.dense = 0;
+            r.row = 0;
+            //std::snprintf(r.name, 16, desc.name);
+
+            r.dense = m_entityIndex.PushBack(e.GetFullId(), r);
+            EntityRecord& er = *GetEntityRecord(e.GetFullId());
+            er.dense = r.dense;
+
+            ResolveEntityDesc(er, desc);
+
+            return e;
+        }
+        else
+        {
+            Entity e(GetId().second, this);
+
+            //the row is written with the id of the desc
+            desc.id = e.GetFullId();
+
+            EntityRecord r;
+            r.archetype = nullptr;
+            r.dense = 0;
+            r.row = 0;
+            //std::snprintf(r.name, 16, desc.name);
+
+            r.dense = m_entityIndex.PushBack(e.GetFullId(), r);
+            EntityRecord& er = *GetEntityRecord(e.GetFullId());
+            er.dense = r.dense;
+
+            ResolveEntityDesc(er, desc);
+
+            return e;
+        }
+    }
+
+    EntityRecord* World::GetEntityRecord(EntityId eId)
+    {
+        EntityRecord* e = m_entityIndex.GetPageData(eId);
+
+        if(!e)
+        {
+            return nullptr;
+        }
+        else
+        {
+            return e;
+        }
+    }
+
+    void World::ResolveEntityDesc(EntityRecord& r, EntityDesc& desc)
+    {
+        ComponentSet cs;
+        Archetype* destArchetype = r.archetype;
+        if(desc.parent != 0)
+        {
+            if(!m_componentIndex.ContainsKey(MakePair(ComponentTypeId<ChildOf>::id, desc.parent)))
+            {
+                TypeInfo* ti = new (m_wAllocator.Alloc(sizeof(TypeInfo))) TypeInfo();
+                *ti = *(m_typeInfos[ComponentTypeId<ChildOf>::id]);
+                ti->flags |= FULL_PAIR;
+                ti->id = MakePair(ComponentTypeId<ChildOf>::id, desc.parent);
+
+                TypeInfoBuilder<> builder{*ti, this};
+                char name[30];
+                std::snprintf(name, 30, "ChildOf %u", LO_ENTITY_ID(desc.parent));
+                builder.Register(name);
+            }
+
+            destArchetype = GetOrCreateArchetype_Add(destArchetype, MakePair(ComponentTypeId<ChildOf>::id, desc.parent));
+        }
+        if(desc.name)
+        {
+            destArchetype = GetOrCreateArchetype_Add(destArchetype, ComponentTypeId<EcsName>::id);
+        }
+
+        if(destArchetype)
+        {
+            if(destArchetype->count == destArchetype->capacity)
+            {
+                GrowArchetype(*destArchetype);
+            }
+
+            for(uint32_t i = 0; i < destArchetype->components.count; i++)
+            {
+                //skip no data tag and pair
+                int32_t destColIdx = destArchetype->componentMap[i];
+
+                if(destColIdx == -1)
+                {
+                    continue;
+                }
+
+                TypeInfo& ti = *destArchetype->columns[destColIdx].typeInfo;
+
+                void* dest = destArchetype->GetColumnData(destColIdx, destArchetype->count);
+
+                if(destArchetype->components.idArr[i] == EcsNameId && desc.name)
+                {
+                    EcsName name;
+                    std::snprintf(name.name, 16, desc.name);
+                    ti.hook.moveCtor(dest, &name);
+                }
+            }
+
+            MoveToggleBits(*destArchetype, destArchetype->count, nullptr, 0);
+            MarkChunkChanged(*destArchetype, destArchetype->GetChunkIndex(destArchetype->count));
+
+            destArchetype->GetEntity(destArchetype->count) = desc.id;
+            r.archetype = destArchetype;
+            r.row = destArchetype->count;
+            ++destArchetype->count;
+        }
+    }
+
+    void World::AddComponent(EntityId eId, EntityId cId)
+    {
+        if(m_isDefered)
+        {
+            GetCommandBuffer().Push(CommandType::AddComponent, eId, cId);
+            return;
+        }
+
+        assert(IsAlive(eId) && "Entity is not alive!");
+        EntityRecord* r = m_entityIndex.GetPageData(eId);
+        TypeInfo* cTi = m_typeInfos[cId];
+
+        assert(r);
+
+        if(cTi->IsSparse())
+        {
+            AddSparse(*GetSparseStorage(cId), eId);
+            Emit(EventType::OnAdd, cId, eId, r->archetype);
+            return;
+        }
+
+        if(r->archetype)
+        {
+            int32_t s = r->archetype->components.Search(cId);
+
+            assert(s == -1);
+        }
+
+        Archetype* destArchetype = GetOrCreateArchetype_Add(r->archetype, cId);
+
+        MoveArchetype_Add(eId, *r, destArchetype);
+
+        Emit(EventType::OnAdd, cId, eId, r->archetype);
+    }
+
+    EntityId World::RegisterPair(EntityId first, EntityId second)
+    {
+        assert(first != WildcardId && second != WildcardId && "Wildcards are only query terms!");
+
+        EntityId pairId = MakePair(first, second);
+
+        if(!m_componentIndex.ContainsKey(pairId))
+        {
+            TypeInfo* pTi = m_typeInfos.GetValue(first);
+            TypeInfo* ti = new (m_wAllocator.Alloc(sizeof(TypeInfo))) TypeInfo();
+            *ti = *pTi;
+            ti->flags |= FULL_PAIR;
+            ti->id = pairId;
+
+            TypeInfoBuilder<> builder{*ti, this};
+            char name[30];
+
+            ///std::snprintf(name, 30, )
+            builder.Register("Child of");
+        }
+
+        return pairId;
+    }
+
+    void World::AddPair(EntityId eId, EntityId first, EntityId second)
+    {
+        if(m_isDefered)
+        {
+            GetCommandBuffer().Push(CommandType::AddComponent, eId, MakePair(first, second));
+            return;
+        }
+
+        EntityId pairId = RegisterPair(first, second);
+        TypeInfo* pTi = m_typeInfos.GetValue(first);
+
+        assert(IsAlive(eId) && "Entity is not alive!");
+        EntityRecord* r = m_entityIndex.GetPageData(eId);
+
+        assert(r);
+        assert(!r->archetype || !r->archetype->components.Has(pairId));
+
+        if(pTi->IsExclusive() && r->archetype)
+        {
+            if(r->archetype->components.HasPair(first))
+            {
+                return;
+            }
+        }
+
+        if(first == DependOnId)
+        {
+            m_isScheduleDirty = true;
+        }
+
+        Archetype* destArchetype = GetOrCreateArchetype_Add(r->archetype, pairId);
+
+        MoveArchetype_Add(eId, *r, destArchetype);
+
+        Emit(EventType::OnAdd, pairId, eId, r->archetype);
+    }
+
+    void World::AddTag(EntityId eId, EntityId cId)
+    {
+        if(m_isDefered)
+        {
+            GetCommandBuffer().Push(CommandType::AddComponent, eId, cId);
+            return;
+        }
+
+        assert(IsAlive(eId) && "Entity is not alive!");
+        EntityRecord* r = m_entityIndex.GetPageData(eId);
+
+        assert(r);
+
+        TypeInfo* pti = m_typeInfos.GetValue(cId);
+
+        if(pti->IsSparse())
+        {
+            AddSparse(*GetSparseStorage(cId), eId);
+            Emit(EventType::OnAdd, cId, eId, r->archetype);
+            return;
+        }
+
+        assert(!r->archetype || !r->archetype->components.Has(cId));
+
+        if(pti->IsExclusive() && r->archetype)
+        {
+            assert(!r->archetype->components.HasPair(cId));
+        }
+
+        Archetype* destArchetype = GetOrCreateArchetype_Add(r->archetype, cId);
+
+        MoveArchetype_Add(eId, *r, destArchetype);
+
+        Emit(EventType::OnAdd, cId, eId, r->archetype);
+    }
+
+    void World::RemoveComponent(EntityId eId, EntityId cId)
+    {
+        if(m_isDefered)
+        {
+            GetCommandBuffer().Push(CommandType::RemoveComponent, eId, cId);
+            return;
+        }
+
+        assert(IsAlive(eId) && "Entity is not alive!");
+        EntityRecord* r = m_entityIndex.GetPageData(eId);
+
+        assert(r);
+
+        if(SparseStorage* storage = GetSparseStorage(cId))
+        {
+            RemoveSparse(*storage, eId);
+            Emit(EventType::OnRemove, cId, eId, r->archetype);
+            return;
+        }
+
+        assert(r->archetype);
+        Archetype* srcArchetype = r->archetype;
+        int32_t s = srcArchetype->components.Search(cId);
+
+        assert(s != -1);
+
+        Archetype* destArchetype = GetOrCreateArchetype_Remove(srcArchetype, cId);
+
+        MoveArchetype_Remove(eId, *r, destArchetype);
+
+        if(LO_ENTITY_ID(cId) == DependOnId && HI_ENTITY_ID(cId) != 0)
+        {
+            m_isScheduleDirty = true;
+        }
+
+        Emit(EventType::OnRemove, cId, eId, srcArchetype);
+    }
+
+    void World::AddToggle(EntityId eId, EntityId cId)
+    {
+        assert(!GetSparseStorage(cId) && "Sparse components can not be toggled!");
+
+        AddPair(eId, ToggleId, cId);
+    }
+
+    void World::SetEnabled(EntityId eId, EntityId cId, bool isEnabled)
+    {
+        //bits of a chunk are shared by the rows of parallel jobs
+        if(m_isDefered)
+        {
+            GetCommandBuffer().Push(isEnabled ? CommandType::EnableComponent : CommandType::DisableComponent, eId, cId);
+            return;
+        }
+
+        assert(IsAlive(eId) && "Entity is not alive!");
+        EntityRecord* r = m_entityIndex.GetPageData(eId);
+
+        assert(r);
+        assert(r->archetype);
+
+        int32_t toggleIdx = r->archetype->GetToggleIndex(cId);
+
+        assert(toggleIdx != -1 && "Component is not toggleable on the entity!");
+
+        r->archetype->SetEnabled(toggleIdx, r->row, isEnabled);
+    }
+
+    bool World::IsEnabled(EntityId eId, EntityId cId)
+    {
+        assert(IsAlive(eId) && "Entity is not alive!");
+        EntityRecord* r = m_entityIndex.GetPageData(eId);
+
+        assert(r);
+
+        int32_t toggleIdx = r->archetype ? r->archetype->GetToggleIndex(cId) : -1;
+
+        return toggleIdx == -1 || r->archetype->IsEnabled(toggleIdx, r->row);
+    }
+
+    void World::Set(EntityId eId, EntityId cId, void* data)
+    {
+        if(m_isDefered)
+        {
+            TypeInfo& ti = *m_typeInfos[cId];
+            void* cmdData = GetCommandBuffer().PushData(ti.size, ti.alignment);
+
+            if(ti.hook.moveCtor)
+            {
+                ti.hook.moveCtor(cmdData, data);
+            }
+            else if(ti.hook.copyCtor)
+            {
+                ti.hook.copyCtor(cmdData, data);
+            }
+            else
+            {
+                std::memcpy(cmdData, data, ti.size);
+            }
+
+            GetCommandBuffer().Push(CommandType::Set, eId, cId, cmdData);
+            return;
+        }
+
+        TypeInfo* cTi = nullptr;
+        void* component = GetComponentData(eId, cId, cTi, true);
+        TypeInfo& ti = *cTi;
+
+        if(ti.IsSoa())
+        {
+            EntityRecord* r = m_entityIndex.GetPageData(eId);
+            WriteSoaRow(*r->archetype, GetColumnIndex(r->archetype, cId), r->row, data);
+            Emit(EventType::OnSet, cId, eId, r->archetype);
+            return;
+        }
+
+        if (ti.hook.moveCtor)
+        {
+            ti.hook.moveCtor(component, data);
+        }
+        else if (ti.hook.copyCtor)
+        {
+            ti.hook.copyCtor(component, data);
+        }
+        else
+        {
+            std::memcpy(component, data, ti.size);
+        }
+
+        Emit(EventType::OnSet, cId, eId, m_entityIndex.GetPageData(eId)->archetype);
+    }
+
+    void World::Set(EntityId eId, EntityId cId, const void* data)
+    {
+        if(m_isDefered)
+        {
+            TypeInfo& ti = *m_typeInfos[cId];
+            void* cmdData = GetCommandBuffer().PushData(ti.size, ti.alignment);
+
+            if(ti.hook.copyCtor)
+            {
+                ti.hook.copyCtor(cmdData, data);
+            }
+            else
+            {
+                std::memcpy(cmdData, data, ti.size);
+            }
+
+            GetCommandBuffer().Push(CommandType::Set, eId, cId, cmdData);
+            return;
+        }
+
+        TypeInfo* cTi = nullptr;
+        void* component = GetComponentData(eId, cId, cTi, true);
+        TypeInfo& ti = *cTi;
+
+        if(ti.IsSoa())
+        {
+            EntityRecord* r = m_entityIndex.GetPageData(eId);
+            WriteSoaRow(*r->archetype, GetColumnIndex(r->archetype, cId), r->row, data);
+            Emit(EventType::OnSet, cId, eId, r->archetype);
+            return;
+        }
+
+        if (ti.hook.copyCtor)
+        {
+            ti.hook.copyCtor(component, data);
+        }
+        else
+        {
+            std::memcpy(component, data, ti.size);
+        }
+
+        Emit(EventType::OnSet, cId, eId, m_entityIndex.GetPageData(eId)->archetype);
+    }
+
+    void* World::Get(EntityId eId, EntityId cId)
+    {
+        TypeInfo* ti = nullptr;
+        void* data = GetComponentData(eId, cId, ti, true);
+        assert((data || !ti->IsSoa()) && "SoA components are accessed through Soa<T> views!");
+
+        return data;
+    }
+
+    const void* World::GetConst(EntityId eId, EntityId cId)
+    {
+        TypeInfo* ti = nullptr;
+        const void* data = GetComponentData(eId, cId, ti, false);
+        assert((data || !ti->IsSoa()) && "SoA components are accessed through Soa<T> views!");
+
+        return data;
+    }
+
+    void* World::GetComponentData(EntityId eId, EntityId cId, TypeInfo*& ti, bool isWrite)
+    {
+        assert(IsAlive(eId) && "Entity is not alive!");
+        EntityRecord* r = m_entityIndex.GetPageData(eId);
+        assert(r);
+        assert(r->dense);
+
+        int32_t colIdx = r->archetype ? GetColumnIndex(r->archetype, cId) : -1;
+
+        //not in the archetype, only a sparse component can still be there
+        if(colIdx == -1)
+        {
+            SparseStorage* storage = GetSparseStorage(cId);
+            assert(storage && "Entity does not have the component!");
+
+            uint32_t* slot = storage->TryGetSlot(eId);
+            assert(slot && "Entity does not have the component!");
+
+            ti = storage->typeInfo;
+
+            return storage->GetData(*slot);
+        }
+
+        ti = r->archetype->columns[colIdx].typeInfo;
+
+        if(isWrite)
+        {
+            r->archetype->GetChunkTicks(r->archetype->GetChunkIndex(r->row))[colIdx] = m_changeTick;
+        }
+
+        //structure of arrays columns have no whole component to point at
+        if(ti->IsSoa())
+        {
+            return nullptr;
+        }
+
+        return r->archetype->GetColumnData(colIdx, r->row);
+    }
+    
+    int32_t World::GetColumnIndex(Archetype* archetype, EntityId cId)
+    {
+        //paged id lookup, cheaper than probing the type info map
+        uint32_t* denseIndex = HI_ENTITY_ID(cId) == 0 ? m_denseIndices.TryGetPageData(cId) : nullptr;
+
+        if(denseIndex)
+        {
+            return archetype->GetDenseColumn(*denseIndex);
+        }
+
+        int32_t idx = archetype->components.Search(cId);
+
+        return idx == -1 ? -1 : archetype->componentMap[idx];
+    }
+
+    void World::InitArchetypeChunkLayout(Archetype& archetype)
+    {
+        uint32_t rowSize = sizeof(EntityId);
+
+        for(uint32_t idx = 0; idx < archetype.columnCount; idx++)
+        {
+            rowSize += archetype.columns[idx].typeInfo->size;
+        }
+
+        uint32_t rowShift = MinChunkRowShift;
+
+        while(((2u << rowShift) * rowSize) <= ArchetypeChunkSize)
+        {
+            ++rowShift;
+        }
+
+        //alignment padding between columns can push the layout over the chunk size
+        while(true)
+        {
+            uint32_t rows = 1u << rowShift;
+            uint32_t offset = sizeof(EntityId) * rows;
+
+            for(uint32_t idx = 0; idx < archetype.columnCount; idx++)
+            {
+                TypeInfo& ti = *archetype.columns[idx].typeInfo;
+                assert(ti.alignment <= MaxChunkAlign && "Component alignment is over the chunk alignment!");
+
+                offset = Align(offset, std::max(ti.alignment, ColumnAlignment));
+                archetype.columns[idx].offset = offset;
+                offset += ti.size * rows;
+            }
+
+            for(uint32_t idx = 0; idx < archetype.toggleCount; idx++)
+            {
+                offset = Align(offset, alignof(uint64_t));
+                archetype.toggles[idx].offset = offset;
+                offset += sizeof(uint64_t) * ((rows + 63) >> 6);
+            }
+
+            if(offset <= ArchetypeChunkSize || rowShift == MinChunkRowShift)
+            {
+                archetype.chunkRowShift = rowShift;
+                archetype.chunkByteSize = std::max(Align(offset, MinChunkAlign), ArchetypeChunkSize);
+                break;
+            }
+
+            --rowShift;
+        }
+    }
+
+    void* World::AllocArchetypeChunk(Archetype& archetype)
+    {
+        if(archetype.chunkByteSize == ArchetypeChunkSize)
+        {
+            return m_allocators.chunks.Alloc();
+        }
+
+        return m_wAllocator.Alloc(archetype.chunkByteSize);
+    }
+
+    void World::FreeArchetypeChunk(Archetype& archetype, void* chunk)
+    {
+        if(archetype.chunkByteSize == ArchetypeChunkSize)
+        {
+            m_allocators.chunks.Free(chunk);
+        }
+        else
+        {
+            m_wAllocator.Free(archetype.chunkByteSize, chunk);
+        }
+    }
+
+    void World::GrowArchetype(Archetype& archetype)
+    {
+        if(archetype.chunks.count == archetype.chunks.capacity)
+        {
+            archetype.chunks.Grow(m_wAllocator);
+        }
+
+        ArchetypeChunk chunk;
+        chunk.data = AllocArchetypeChunk(archetype);
+
+        assert(chunk.data && "Archetype chunk is null!");
+
+        chunk.ticks = archetype.columnCount ?
+            PTR_CAST(m_wAllocator.Alloc(sizeof(uint32_t) * archetype.columnCount), uint32_t) : nullptr;
+
+        archetype.chunks.Add(chunk);
+        archetype.capacity += archetype.GetChunkCapacity();
+
+        MarkChunkChanged(archetype, archetype.chunks.count - 1);
+    }
+
+    void World::ReserveArchetype(Archetype& archetype, uint32_t count)
+    {
+        uint32_t chunkCapacity = archetype.GetChunkCapacity();
+        uint32_t chunkCount = (archetype.count + count + chunkCapacity - 1) >> archetype.chunkRowShift;
+
+        while(archetype.chunks.capacity < chunkCount)
+        {
+            archetype.chunks.Grow(m_wAllocator);
+        }
+
+        while(archetype.chunks.count < chunkCount)
+        {
+            GrowArchetype(archetype);
+        }
+    }
+
+    void World::ShrinkArchetype(Archetype& archetype)
+    {
+        uint32_t chunkCapacity = archetype.GetChunkCapacity();
+        uint32_t chunkCount = ((archetype.count + chunkCapacity - 1) >> archetype.chunkRowShift) + 1;
+
+        while(archetype.chunks.count > chunkCount)
+        {
+            ArchetypeChunk& chunk = archetype.chunks.store[archetype.chunks.count - 1];
+
+            FreeArchetypeChunk(archetype, chunk.data);
+
+            if(chunk.ticks)
+            {
+                m_wAllocator.Free(sizeof(uint32_t) * archetype.columnCount, chunk.ticks);
+            }
+
+            --archetype.chunks.count;
+            archetype.capacity -= chunkCapacity;
+        }
+    }
+
+    void World::RemoveRow(Archetype& archetype, uint32_t row)
+    {
+        assert(row < archetype.count);
+
+        uint32_t backRow = archetype.count - 1;
+
+        if(row != backRow)
+        {
+            EntityId backId = archetype.GetEntity(backRow);
+            EntityRecord* backRecord = m_entityIndex.GetPageData(backId);
+            assert(backRecord);
+
+            archetype.GetEntity(row) = backId;
+
+            for(uint32_t i = 0; i < archetype.columnCount; i++)
+            {
+                MoveColumnRows(archetype, i, row, archetype, i, backRow, 1);
+            }
+
+            for(uint32_t i = 0; i < archetype.toggleCount; i++)
+            {
+                archetype.SetEnabled(i, row, archetype.IsEnabled(i, backRow));
+            }
+
+            MarkChunkChanged(archetype, archetype.GetChunkIndex(row));
+
+            backRecord->row = row;
+        }
+
+        --archetype.count;
+
+        ShrinkArchetype(archetype);
+    }
+
+    void World::MoveToggleBits(Archetype& destArchetype, uint32_t destRow, Archetype* srcArchetype, uint32_t srcRow)
+    {
+        for(uint32_t i = 0; i < destArchetype.toggleCount; i++)
+        {
+            int32_t srcIdx = srcArchetype ? srcArchetype->GetToggleIndex(destArchetype.toggles[i].id) : -1;
+
+            destArchetype.SetEnabled(i, destRow, srcIdx == -1 || srcArchetype->IsEnabled(srcIdx, srcRow));
+        }
+    }
+
+    void World::MarkChunkChanged(Archetype& archetype, uint32_t chunkIdx)
+    {
+        uint32_t* ticks = archetype.GetChunkTicks(chunkIdx);
+
+        for(uint32_t colIdx = 0; colIdx < archetype.columnCount; colIdx++)
+        {
+            ticks[colIdx] = m_changeTick;
+        }
+    }
+
+    uint32_t World::GetChildDepth(EntityId parent)
+    {
+        EntityRecord* r = m_entityIndex.TryGetPageData(parent);
+
+        //a parent that is not alive or has no component is a root
+        if(!r || !r->archetype)
+        {
+            return 1;
+        }
+
+        return r->archetype->depth + 1;
+    }
+
+    void World::UpdateChildDepth(EntityId parent)
+    {
+        ComponentRecord* cr = m_componentIndex.TryGetValue(MakePair(ChildOfId, LO_ENTITY_ID(parent)));
+
+        if(!cr)
+        {
+            return;
+        }
+
+        uint32_t depth = GetChildDepth(parent);
+
+        //every child archetype of a parent has the same depth, only changed subtrees are walked
+        for(uint32_t aIdx = 0; aIdx < cr->archetypeStore.count; aIdx++)
+        {
+            Archetype* archetype = cr->archetypeStore.store[aIdx];
+
+            if(archetype->depth == depth)
+            {
+                continue;
+            }
+
+            archetype->depth = depth;
+            ++m_hierarchyVersion;
+
+            for(uint32_t row = 0; row < archetype->count; row++)
+            {
+                UpdateChildDepth(archetype->GetEntity(row));
+            }
+        }
+    }
+
+    void World::SortCascadeOrder(Query* query)
+    {
+        if(query->cascadeOrder.count == query->archetypes.count && query->cascadeVersion == m_hierarchyVersion)
+        {
+            return;
+        }
+
+        query->cascadeOrder.count = 0;
+
+        for(uint32_t aIdx = 0; aIdx < query->archetypes.count; aIdx++)
+        {
+            if(query->cascadeOrder.count == query->cascadeOrder.capacity)
+            {
+                query->cascadeOrder.Grow(m_wAllocator);
+            }
+
+            query->cascadeOrder.Add(aIdx);
+        }
+
+        Archetype** archetypes = query->archetypes.store;
+
+        //stable, archetypes of a depth keep their match order
+        std::stable_sort(query->cascadeOrder.store, query->cascadeOrder.store + query->cascadeOrder.count,
+                         [archetypes](uint32_t a, uint32_t b)
+                         {
+                             return archetypes[a]->depth < archetypes[b]->depth;
+                         });
+
+        query->cascadeVersion = m_hierarchyVersion;
+    }
+
+    Archetype* World::CreateArchetype(ComponentSet&& componentSet)
+    {
+        ArchetypeId id = GetArchetypeId();
+        Archetype archetype;
+        archetype.id = id;
+        archetype.count = 0;
+        archetype.capacity = 0;
+        archetype.components = componentSet;
+        archetype.addEdges.Init(&m_wAllocator, DefaultArchetypeEdgeCount);
+        archetype.removeEdges.Init(&m_wAllocator, DefaultArchetypeEdgeCount);
+        archetype.chunks.Init(m_wAllocator);
+
+        archetype.columns =
+            PTR_CAST(m_wAllocator.Alloc(sizeof(Column) * componentSet.count), Column);
+        archetype.componentMap =
+            PTR_CAST(m_wAllocator.Calloc(sizeof(int32_t) * componentSet.count * 2), int32_t);
+
+        for(uint32_t idx = 0; idx < componentSet.count; idx++)
+        {
+            if(m_typeInfos[componentSet.idArr[idx]]->IsDataBitset())
+            {
+                ++archetype.toggleCount;
+            }
+        }
+
+        if(archetype.toggleCount)
+        {
+            archetype.toggles =
+                PTR_CAST(m_wAllocator.Alloc(sizeof(ToggleColumn) * archetype.toggleCount), ToggleColumn);
+        }
+
+        uint32_t dataColCounter = 0;
+        uint32_t toggleCounter = 0;
+        for(uint32_t idx = 0; idx < componentSet.count; idx++)
+        {
+            TypeInfo* ti = m_typeInfos[componentSet.idArr[idx]];
+
+            if(ti->denseIndex != InvalidDenseIndex)
+            {
+                archetype.signature.Set(ti->denseIndex);
+            }
+
+            //(Toggle, component) has no column, its bits live after the columns of every chunk
+            if(ti->IsDataBitset())
+            {
+                archetype.toggles[toggleCounter].id = HI_ENTITY_ID(componentSet.idArr[idx]);
+                archetype.toggles[toggleCounter].offset = 0;
+                ++toggleCounter;
+
+                archetype.componentMap[idx] = -1;
+            }
+            else if(ti->HasData())
+            {
+                archetype.columns[dataColCounter].typeInfo = ti;
+                archetype.columns[dataColCounter].offset = 0;
+
+                archetype.componentMap[idx] = dataColCounter;
+                archetype.componentMap[componentSet.count + dataColCounter] = idx;
+                ++dataColCounter;
+            }
+            else
+            {
+                archetype.componentMap[idx] = -1;
+            }
+        }
+        archetype.columnCount = dataColCounter;
+
+        //pairs share their relation's dense index, they keep going through the component map
+        for(uint32_t colIdx = 0; colIdx < archetype.columnCount; colIdx++)
+        {
+            TypeInfo* ti = archetype.columns[colIdx].typeInfo;
+
+            if(ti->denseIndex != InvalidDenseIndex && !ti->IsFullPair())
+            {
+                archetype.denseColumnCount = std::max(archetype.denseColumnCount, ti->denseIndex + 1);
+            }
+        }
+
+        if(archetype.denseColumnCount)
+        {
+            archetype.denseColumnMap =
+                PTR_CAST(m_wAllocator.Alloc(sizeof(int32_t) * archetype.denseColumnCount), int32_t);
+            std::memset(archetype.denseColumnMap, 0xFF, sizeof(int32_t) * archetype.denseColumnCount);
+
+            for(uint32_t colIdx = 0; colIdx < archetype.columnCount; colIdx++)
+            {
+                TypeInfo* ti = archetype.columns[colIdx].typeInfo;
+
+                if(ti->denseIndex != InvalidDenseIndex && !ti->IsFullPair())
+                {
+                    archetype.denseColumnMap[ti->denseIndex] = colIdx;
+                }
+            }
+        }
+
+        InitArchetypeChunkLayout(archetype);
+
+        int32_t childOfIdx = componentSet.SearchPair(ChildOfId);
+
+        if(childOfIdx != -1)
+        {
+            archetype.depth = GetChildDepth(HI_ENTITY_ID(componentSet.idArr[childOfIdx]));
+        }
+
+        m_archetypes.PushBack(id, std::move(archetype));
+        Archetype* rArchetype = m_archetypes.GetPageData(id);
+
+        //NOTE: Test this
+        for(uint32_t idx = 0; idx < componentSet.count; idx++)
+        {
+            ComponentRecord& cr = m_componentIndex[componentSet.idArr[idx]];
+            bool isFullPair = cr.typeInfo->IsFullPair();
+
+            //union pair
+            if(isFullPair)
+            {
+                ComponentRecord& pCr = m_componentIndex[LO_ENTITY_ID(componentSet.idArr[idx])];
+
+                if(pCr.archetypeStore.count == pCr.archetypeStore.capacity)
+                {
+                    pCr.archetypeStore.Grow(m_wAllocator);
+                }
+
+                pCr.archetypeStore.store[pCr.archetypeStore.count] = rArchetype;
+                ++pCr.archetypeStore.count;
+            }
+
+            if(cr.archetypeStore.count == cr.archetypeStore.capacity)
+            {
+                cr.archetypeStore.Grow(m_wAllocator);
+            }
+
+            cr.archetypeStore.store[cr.archetypeStore.count] = rArchetype;
+            ++cr.archetypeStore.count;
+
+            //target index, last since creating the record can rehash the component index
+            if(isFullPair)
+            {
+                ComponentRecord& tCr = GetOrCreateTargetRecord(HI_ENTITY_ID(componentSet.idArr[idx]));
+
+                //pairs of one target are adjacent in the set, the archetype is added once
+                if(tCr.archetypeStore.count == 0 || tCr.archetypeStore.store[tCr.archetypeStore.count - 1] != rArchetype)
+                {
+                    if(tCr.archetypeStore.count == tCr.archetypeStore.capacity)
+                    {
+                        tCr.archetypeStore.Grow(m_wAllocator);
+                    }
+
+                    tCr.archetypeStore.store[tCr.archetypeStore.count] = rArchetype;
+                    ++tCr.archetypeStore.count;
+                }
+            }
+        }
+
+        m_mappedArchetype.Insert(componentSet, rArchetype);
+
+        MatchQueries(rArchetype);
+
+        return rArchetype;
+    }
+
+    Archetype* World::GetArchetype(const ComponentSet& componentSet)
+    {
+        Archetype** archetype = m_mappedArchetype.TryGetValue(componentSet);
+
+        return archetype ? *archetype : nullptr;
+    }
+
+    Archetype* World::GetOrCreateArchetype_Add(Archetype* src, EntityId cId)
+    {
+        uint32_t srcCount = 0;
+        if(src)
+        {
+            srcCount = src->components.count;
+        }
+
+        Archetype* dest = nullptr;
+
+        //find or create edge
+        if(src)
+        {
+            Archetype** edge = src->addEdges.TryGetValue(cId);
+
+            if(edge)
+            {
+                dest = *edge;
+            }
+            else
+            {
+                //CREATE EDEGE
+                uint32_t count = srcCount + 1;
+
+                ComponentSet cs;
+                cs.Alloc(m_wAllocator, count);
+                std::memcpy(cs.idArr, src->components.idArr, srcCount * sizeof(EntityId));
+                cs.idArr[count - 1] = cId;
+                cs.count = count;
+                cs.Sort();
+
+                dest = GetArchetype(cs);
+
+                if(!dest)
+                {
+                    dest = CreateArchetype(std::move(cs));
+                }
+                else
+                {
+                    cs.Free(m_wAllocator);
+                }
+
+                src->addEdges.Insert(cId, dest);
+
+                //reverse edge, a deleted archetype finds every neighbour through its own edges
+                if(!dest->removeEdges.ContainsKey(cId))
+                {
+                    dest->removeEdges.Insert(cId, src);
+                }
+            }
+        }
+        else
+        {
+            ComponentSet cs;
+            cs.Alloc(m_wAllocator, 1);
+            cs.idArr[0] = cId;
+            cs.count = 1;
+
+            dest = GetArchetype(cs);
+
+            if(!dest)
+            {
+                dest = CreateArchetype(std::move(cs));
+            }
+            else
+            {
+                cs.Free(m_wAllocator);
+            }
+        }
+
+        assert(dest);
+
+        return dest;
+    }
+
+    Archetype* World::GetOrCreateArchetype_Remove(Archetype* src, EntityId cId)
+    {
+        assert(src);
+
+        uint32_t srcCount = 0;
+        srcCount = src->components.count;
+
+        Archetype* dest = nullptr;
+
+        Archetype** edge = src->removeEdges.TryGetValue(cId);
+
+        if(edge)
+        {
+            dest = *edge;
+        }
+        else
+        {
+            //CREATE EDEGE
+            uint32_t count = srcCount - 1;
+            
+            assert(count >= 0);
+            if(count == 0)
+            {
+                return nullptr;
+            }
+            else
+            {
+                ComponentSet cs;
+                cs.Alloc(m_wAllocator, count);
+                cs.count = count;
+
+                //TODO: Review this later
+                int32_t rIdx = src->components.Search(cId);
+                assert(rIdx != -1);
+
+                std::memcpy(cs.idArr, src->components.idArr, rIdx * sizeof(EntityId));
+                std::memcpy(cs.idArr + rIdx, src->components.idArr + rIdx + 1, (srcCount - rIdx - 1) * sizeof(EntityId));
+                cs.Sort();
+
+                dest = GetArchetype(cs);
+
+                if(!dest)
+                {
+                    dest = CreateArchetype(std::move(cs));
+                }
+                else
+                {
+                    cs.Free(m_wAllocator);
+                }
+
+                src->removeEdges.Insert(cId, dest);
+
+                if(!dest->addEdges.ContainsKey(cId))
+                {
+                    dest->addEdges.Insert(cId, src);
+                }
+            }
+        }
+
+        return dest;
+    }
+
+    void World::MoveArchetype_Add(EntityId eId, EntityRecord& r, Archetype* destArchetype)
+    {
+        assert(destArchetype);
+
+        if(destArchetype->count == destArchetype->capacity)
+        {
+            GrowArchetype(*destArchetype);
+        }
+
+        uint32_t destRow = destArchetype->count;
+
+        //empty entity
+        if(!r.archetype)
+        {
+            if(destArchetype->columnCount == 1)
+            {
+                ConstructColumnRows(*destArchetype, 0, destRow, 1);
+            }
+
+            MoveToggleBits(*destArchetype, destRow, nullptr, 0);
+        }
+        //at least 1 component
+        else
+        {
+            Archetype* srcArchetype = r.archetype;
+
+            for(uint32_t i = 0; i < destArchetype->components.count; i++)
+            {
+                //skip no data tag and pair
+                int32_t destColIdx = destArchetype->componentMap[i];
+
+                if(destColIdx == -1)
+                {
+                    continue;
+                }
+
+                int32_t srcIndex = srcArchetype->components.Search(destArchetype->components.idArr[i]);
+
+                if(srcIndex == -1)
+                {
+                    ConstructColumnRows(*destArchetype, destColIdx, destRow, 1);
+                }
+                else
+                {
+                    int32_t srcColIdx = srcArchetype->componentMap[srcIndex];
+
+                    if(srcColIdx == -1)
+                    {
+                        assert(0 && "Mismatch type");
+                    }
+
+                    MoveColumnRows(*destArchetype, destColIdx, destRow, *srcArchetype, srcColIdx, r.row, 1);
+                }
+            }
+
+            MoveToggleBits(*destArchetype, destRow, srcArchetype, r.row);
+
+            //fill the hole from the back row
+            RemoveRow(*srcArchetype, r.row);
+        }
+
+        MarkChunkChanged(*destArchetype, destArchetype->GetChunkIndex(destRow));
+
+        uint32_t srcDepth = r.archetype ? r.archetype->depth : 0;
+
+        destArchetype->GetEntity(destRow) = eId;
+        r.archetype = destArchetype;
+        r.row = destRow;
+        ++destArchetype->count;
+
+        if(srcDepth != destArchetype->depth)
+        {
+            UpdateChildDepth(eId);
+        }
+    }
+
+    void World::MoveArchetype_Remove(EntityId eId, EntityRecord& r, Archetype* destArchetype)
+    {
+        Archetype* srcArchetype = r.archetype;
+
+        if(!destArchetype)
+        {
+            if(srcArchetype->columnCount == 1 && srcArchetype->components.count == 1)
+            {
+                TypeInfo& ti = *srcArchetype->columns[0].typeInfo;
+
+                if(ti.HasData() && ti.hook.dtor)
+                {
+                    void* src = srcArchetype->GetColumnData(0, r.row);
+                    ti.hook.dtor(src);
+                }
+            }
+            else if(srcArchetype->columnCount != 0)
+            {
+                assert(0);
+            }
+
+            RemoveRow(*srcArchetype, r.row);
+
+            r.row = 0;
+            r.archetype = destArchetype;
+
+            if(srcArchetype->depth != 0)
+            {
+                UpdateChildDepth(eId);
+            }
+        }
+        else
+        {
+            if(destArchetype->count == destArchetype->capacity)
+            {
+                GrowArchetype(*destArchetype);
+            }
+
+            uint32_t destRow = destArchetype->count;
+
+            for(uint32_t idx = 0; idx < srcArchetype->components.count; idx++)
+            {
+                int32_t srcColIdx = srcArchetype->componentMap[idx];
+
+                if(srcColIdx == -1)
+                {
+                    continue;
+                }
+
+                TypeInfo& ti = *srcArchetype->columns[srcColIdx].typeInfo;
+
+                int32_t destIdx = destArchetype->components.Search(srcArchetype->components.idArr[idx]);
+                if(destIdx != -1)
+                {
+                    int32_t destColIdx = destArchetype->componentMap[destIdx];
+
+                    assert(destColIdx != -1);
+
+                    MoveColumnRows(*destArchetype, destColIdx, destRow, *srcArchetype, srcColIdx, r.row, 1);
+                }
+                else if(ti.hook.dtor)
+                {
+                    ti.hook.dtor(srcArchetype->GetColumnData(srcColIdx, r.row));
+                }
+            }
+
+            MoveToggleBits(*destArchetype, destRow, srcArchetype, r.row);
+            MarkChunkChanged(*destArchetype, destArchetype->GetChunkIndex(destRow));
+
+            RemoveRow(*srcArchetype, r.row);
+
+            destArchetype->GetEntity(destRow) = eId;
+            r.archetype = destArchetype;
+            r.row = destRow;
+            ++destArchetype->count;
+
+            if(srcArchetype->depth != destArchetype->depth)
+            {
+                UpdateChildDepth(eId);
+            }
+        }
+    }
+    
+    void World::MoveArchetype(EntityId eId, EntityRecord& r, Archetype* destArchetype)
+    {
+        Archetype* srcArchetype = r.archetype;
+        uint32_t destRow = 0;
+
+        if(destArchetype)
+        {
+            if(destArchetype->count == destArchetype->capacity)
+            {
+                GrowArchetype(*destArchetype);
+            }
+
+            destRow = destArchetype->count;
+
+            for(uint32_t i = 0; i < destArchetype->components.count; i++)
+            {
+                int32_t destColIdx = destArchetype->componentMap[i];
+
+                if(destColIdx == -1)
+                {
+                    continue;
+                }
+
+                int32_t srcIndex =
+                    srcArchetype ? srcArchetype->components.Search(destArchetype->components.idArr[i]) : -1;
+
+                if(srcIndex == -1)
+                {
+                    ConstructColumnRows(*destArchetype, destColIdx, destRow, 1);
+                    continue;
+                }
+
+                int32_t srcColIdx = srcArchetype->componentMap[srcIndex];
+                assert(srcColIdx != -1 && "Mismatch type");
+
+                MoveColumnRows(*destArchetype, destColIdx, destRow, *srcArchetype, srcColIdx, r.row, 1);
+            }
+
+            MoveToggleBits(*destArchetype, destRow, srcArchetype, r.row);
+            MarkChunkChanged(*destArchetype, destArchetype->GetChunkIndex(destRow));
+
+            destArchetype->GetEntity(destRow) = eId;
+        }
+
+        if(srcArchetype)
+        {
+            //columns the dest does not keep
+            for(uint32_t i = 0; i < srcArchetype->components.count; i++)
+            {
+                int32_t srcColIdx = srcArchetype->componentMap[i];
+
+                if(srcColIdx == -1 ||
+                   (destArchetype && destArchetype->components.Has(srcArchetype->components.idArr[i])))
+                {
+                    continue;
+                }
+
+                TypeInfo& ti = *srcArchetype->columns[srcColIdx].typeInfo;
+
+                if(ti.hook.dtor)
+                {
+                    ti.hook.dtor(srcArchetype->GetColumnData(srcColIdx, r.row));
+                }
+            }
+
+            RemoveRow(*srcArchetype, r.row);
+        }
+
+        r.archetype = destArchetype;
+        r.row = destRow;
+
+        if(destArchetype)
+        {
+            ++destArchetype->count;
+        }
+
+        if((srcArchetype ? srcArchetype->depth : 0) != (destArchetype ? destArchetype->depth : 0))
+        {
+            UpdateChildDepth(eId);
+        }
+    }
+
+    void World::MoveColumnRange(TypeInfo& ti, void* dest, void* src, uint32_t count)
+    {
+        //relocated as raw bytes, the source is left as is
+        if(ti.IsTriviallyRelocatable())
+        {
+            std::memcpy(dest, src, ti.size * count);
+            return;
+        }
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            void* d = OFFSET_ELEMENT(dest, ti.size, i);
+            void* s = OFFSET_ELEMENT(src, ti.size, i);
+
+            if(ti.hook.moveCtor)
+            {
+                ti.hook.moveCtor(d, s);
+            }
+            else if(ti.hook.copyCtor)
+            {
+                ti.hook.copyCtor(d, s);
+            }
+            else
+            {
+                std::memcpy(d, s, ti.size);
+            }
+
+            if(ti.hook.dtor)
+            {
+                ti.hook.dtor(s);
+            }
+        }
+    }
+
+    void World::MoveColumnRows(Archetype& dest, uint32_t destColIdx, uint32_t destRow,
+                               Archetype& src, uint32_t srcColIdx, uint32_t srcRow, uint32_t count)
+    {
+        TypeInfo& ti = *dest.columns[destColIdx].typeInfo;
+
+        if(!ti.IsSoa())
+        {
+            MoveColumnRange(ti, dest.GetColumnData(destColIdx, destRow), src.GetColumnData(srcColIdx, srcRow), count);
+            return;
+        }
+
+        //chunk capacities can differ, every field is one contiguous span in both
+        for(uint32_t f = 0; f < ti.soa->fieldCount; f++)
+        {
+            std::memcpy(dest.GetFieldData(destColIdx, f, destRow), src.GetFieldData(srcColIdx, f, srcRow),
+                        ti.soa->sizes[f] * count);
+        }
+    }
+
+    void World::ConstructColumnRows(Archetype& archetype, uint32_t colIdx, uint32_t row, uint32_t count)
+    {
+        TypeInfo& ti = *archetype.columns[colIdx].typeInfo;
+
+        //trivially constructible, the value initialized component is all zero
+        if(ti.IsSoa())
+        {
+            for(uint32_t f = 0; f < ti.soa->fieldCount; f++)
+            {
+                std::memset(archetype.GetFieldData(colIdx, f, row), 0, ti.soa->sizes[f] * count);
+            }
+
+            return;
+        }
+
+        if(!ti.hook.ctor)
+        {
+            return;
+        }
+
+        void* dest = archetype.GetColumnData(colIdx, row);
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            ti.hook.ctor(OFFSET_ELEMENT(dest, ti.size, i));
+        }
+    }
+
+    void World::WriteSoaRow(Archetype& archetype, uint32_t colIdx, uint32_t row, const void* value)
+    {
+        const SoaLayout& soa = *archetype.columns[colIdx].typeInfo->soa;
+
+        for(uint32_t f = 0; f < soa.fieldCount; f++)
+        {
+            std::memcpy(archetype.GetFieldData(colIdx, f, row), OFFSET(value, soa.offsets[f]), soa.sizes[f]);
+        }
+    }
+
+    void World::MoveArchetypeAll(Archetype* srcArchetype, Archetype* destArchetype)
+    {
+        assert(srcArchetype && srcArchetype != destArchetype);
+
+        uint32_t count = srcArchetype->count;
+
+        if(count == 0)
+        {
+            return;
+        }
+
+        //src column of every dest column, -1 is constructed
+        int32_t* srcColumns = nullptr;
+        uint32_t destFirst = 0;
+
+        if(destArchetype)
+        {
+            destFirst = destArchetype->count;
+            ReserveArchetype(*destArchetype, count);
+
+            srcColumns = PTR_CAST(m_wAllocator.Alloc(sizeof(int32_t) * destArchetype->columnCount), int32_t);
+
+            for(uint32_t i = 0; i < destArchetype->components.count; i++)
+            {
+                int32_t destColIdx = destArchetype->componentMap[i];
+
+                if(destColIdx == -1)
+                {
+                    continue;
+                }
+
+                int32_t srcIdx = srcArchetype->components.Search(destArchetype->components.idArr[i]);
+                srcColumns[destColIdx] = srcIdx == -1 ? -1 : srcArchetype->componentMap[srcIdx];
+            }
+        }
+
+        //spans are contiguous in both tables, chunk sizes can differ
+        for(uint32_t srcRow = 0; srcRow < count;)
+        {
+            uint32_t srcChunkIdx = srcArchetype->GetChunkIndex(srcRow);
+            uint32_t srcChunkRow = srcArchetype->GetChunkRow(srcRow);
+            uint32_t spanCount = std::min(srcArchetype->GetChunkCapacity() - srcChunkRow, count - srcRow);
+
+            if(destArchetype)
+            {
+                uint32_t destRow = destFirst + srcRow;
+                uint32_t destChunkIdx = destArchetype->GetChunkIndex(destRow);
+                uint32_t destChunkRow = destArchetype->GetChunkRow(destRow);
+                spanCount = std::min(spanCount, destArchetype->GetChunkCapacity() - destChunkRow);
+
+                std::memcpy(destArchetype->GetChunkEntities(destChunkIdx) + destChunkRow,
+                            srcArchetype->GetChunkEntities(srcChunkIdx) + srcChunkRow,
+                            sizeof(EntityId) * spanCount);
+
+                for(uint32_t destColIdx = 0; destColIdx < destArchetype->columnCount; destColIdx++)
+                {
+                    int32_t srcColIdx = srcColumns[destColIdx];
+
+                    if(srcColIdx == -1)
+                    {
+                        ConstructColumnRows(*destArchetype, destColIdx, destRow, spanCount);
+                        continue;
+                    }
+
+                    MoveColumnRows(*destArchetype, destColIdx, destRow, *srcArchetype, srcColIdx, srcRow, spanCount);
+                }
+
+                for(uint32_t i = 0; i < spanCount && destArchetype->toggleCount; i++)
+                {
+                    MoveToggleBits(*destArchetype, destRow + i, srcArchetype, srcRow + i);
+                }
+
+                MarkChunkChanged(*destArchetype, destChunkIdx);
+            }
+
+            //dropped columns
+            for(uint32_t i = 0; i < srcArchetype->components.count; i++)
+            {
+                int32_t srcColIdx = srcArchetype->componentMap[i];
+
+                if(srcColIdx == -1 ||
+                   (destArchetype && destArchetype->components.Has(srcArchetype->components.idArr[i])))
+                {
+                    continue;
+                }
+
+                TypeInfo& ti = *srcArchetype->columns[srcColIdx].typeInfo;
+
+                if(ti.hook.dtor)
+                {
+                    void* src = OFFSET_ELEMENT(srcArchetype->GetChunkColumn(srcChunkIdx, srcColIdx),
+                                               ti.size, srcChunkRow);
+
+                    for(uint32_t r = 0; r < spanCount; r++)
+                    {
+                        ti.hook.dtor(OFFSET_ELEMENT(src, ti.size, r));
+                    }
+                }
+            }
+
+            srcRow += spanCount;
+        }
+
+        bool isDepthChanged = srcArchetype->depth != (destArchetype ? destArchetype->depth : 0);
+
+        //patch records, rows keep their order
+        for(uint32_t row = 0; row < count; row++)
+        {
+            EntityId eId = srcArchetype->GetEntity(row);
+            EntityRecord* r = m_entityIndex.GetPageData(eId);
+
+            r->archetype = destArchetype;
+            r->row = destArchetype ? destFirst + row : 0;
+
+            if(isDepthChanged)
+            {
+                UpdateChildDepth(eId);
+            }
+        }
+
+        srcArchetype->count = 0;
+        ShrinkArchetype(*srcArchetype);
+
+        if(destArchetype)
+        {
+            destArchetype->count += count;
+            m_wAllocator.Free(sizeof(int32_t) * destArchetype->columnCount, srcColumns);
+        }
+    }
+
+    void World::BulkAddComponent(Query* query, EntityId cId)
+    {
+        assert(!m_isDefered && "Can not bulk add while progressing!");
+        assert(query);
+
+        //sparse components never move the entities, matched rows are added in place
+        if(SparseStorage* storage = GetSparseStorage(cId))
+        {
+            for(uint32_t i = 0; i < query->archetypes.count; i++)
+            {
+                Archetype* archetype = query->archetypes.store[i];
+
+                for(uint32_t row = 0; row < archetype->count; row++)
+                {
+                    EntityId eId = archetype->GetEntity(row);
+
+                    if(storage->Has(eId))
+                    {
+                        continue;
+                    }
+
+                    AddSparse(*storage, eId);
+                    Emit(EventType::OnAdd, cId, eId, archetype);
+                }
+            }
+
+            return;
+        }
+
+        if(HI_ENTITY_ID(cId) != 0)
+        {
+            RegisterPair(LO_ENTITY_ID(cId), HI_ENTITY_ID(cId));
+        }
+
+        bool isExclusive = HI_ENTITY_ID(cId) != 0 && m_typeInfos[LO_ENTITY_ID(cId)]->IsExclusive();
+
+        //new archetypes can match the query while moving, take the current matches
+        Store<Archetype*> srcArchetypes;
+        srcArchetypes.Init(m_wAllocator);
+
+        for(uint32_t i = 0; i < query->archetypes.count; i++)
+        {
+            Archetype* archetype = query->archetypes.store[i];
+
+            if(archetype->count == 0 || archetype->components.Has(cId) ||
+               (isExclusive && archetype->components.HasPair(LO_ENTITY_ID(cId))))
+            {
+                continue;
+            }
+
+            if(srcArchetypes.count == srcArchetypes.capacity)
+            {
+                srcArchetypes.Grow(m_wAllocator);
+            }
+
+            srcArchetypes.Add(archetype);
+        }
+
+        for(uint32_t i = 0; i < srcArchetypes.count; i++)
+        {
+            Archetype* srcArchetype = srcArchetypes.store[i];
+            uint32_t count = srcArchetype->count;
+
+            Archetype* destArchetype = GetOrCreateArchetype_Add(srcArchetype, cId);
+            uint32_t destFirst = destArchetype->count;
+
+            MoveArchetypeAll(srcArchetype, destArchetype);
+
+            //taken after the move, query observers match the dest
+            EmitRows(EventType::OnAdd, cId, *destArchetype, destFirst, count);
+        }
+
+        if(srcArchetypes.count && LO_ENTITY_ID(cId) == DependOnId && HI_ENTITY_ID(cId) != 0)
+        {
+            m_isScheduleDirty = true;
+        }
+
+        srcArchetypes.Destroy(m_wAllocator);
+    }
+
+    void World::BulkRemoveComponent(Query* query, EntityId cId)
+    {
+        assert(!m_isDefered && "Can not bulk remove while progressing!");
+        assert(query);
+
+        if(SparseStorage* storage = GetSparseStorage(cId))
+        {
+            for(uint32_t i = 0; i < query->archetypes.count; i++)
+            {
+                Archetype* archetype = query->archetypes.store[i];
+
+                for(uint32_t row = 0; row < archetype->count; row++)
+                {
+                    EntityId eId = archetype->GetEntity(row);
+
+                    if(!storage->Has(eId))
+                    {
+                        continue;
+                    }
+
+                    RemoveSparse(*storage, eId);
+                    Emit(EventType::OnRemove, cId, eId, archetype);
+                }
+            }
+
+            return;
+        }
+
+        Store<Archetype*> srcArchetypes;
+        srcArchetypes.Init(m_wAllocator);
+
+        for(uint32_t i = 0; i < query->archetypes.count; i++)
+        {
+            Archetype* archetype = query->archetypes.store[i];
+
+            if(archetype->count == 0 || !archetype->components.Has(cId))
+            {
+                continue;
+            }
+
+            if(srcArchetypes.count == srcArchetypes.capacity)
+            {
+                srcArchetypes.Grow(m_wAllocator);
+            }
+
+            srcArchetypes.Add(archetype);
+        }
+
+        for(uint32_t i = 0; i < srcArchetypes.count; i++)
+        {
+            Archetype* srcArchetype = srcArchetypes.store[i];
+            uint32_t count = srcArchetype->count;
+
+            Archetype* destArchetype = GetOrCreateArchetype_Remove(srcArchetype, cId);
+
+            //taken before the move, the dest can be null
+            EmitRows(EventType::OnRemove, cId, *srcArchetype, 0, count);
+
+            MoveArchetypeAll(srcArchetype, destArchetype);
+        }
+
+        if(srcArchetypes.count && LO_ENTITY_ID(cId) == DependOnId && HI_ENTITY_ID(cId) != 0)
+        {
+            m_isScheduleDirty = true;
+        }
+
+        srcArchetypes.Destroy(m_wAllocator);
+    }
+
+    void World::CreateSparseStorage(TypeInfo& ti)
+    {
+        SparseStorage* storage = new (m_wAllocator.Alloc(sizeof(SparseStorage))) SparseStorage();
+        storage->typeInfo = &ti;
+        storage->index.Init(&m_wAllocator, nullptr, 8, false);
+        storage->entities.Init(m_wAllocator);
+        storage->data = nullptr;
+        storage->capacity = 0;
+
+        m_sparseStorages.PushBack(ti.id, storage);
+    }
+
+    SparseStorage* World::GetSparseStorage(EntityId cId)
+    {
+        SparseStorage** storage = HI_ENTITY_ID(cId) == 0 ? m_sparseStorages.TryGetPageData(cId) : nullptr;
+
+        return storage ? *storage : nullptr;
+    }
+
+    void* World::AddSparse(SparseStorage& storage, EntityId eId)
+    {
+        assert(!storage.Has(eId) && "Entity already has the component!");
+
+        uint32_t slot = storage.GetCount();
+        TypeInfo& ti = *storage.typeInfo;
+
+        //grown before the slot is taken, the count is what gets moved
+        if(ti.HasData() && slot == storage.capacity)
+        {
+            GrowSparseStorage(storage);
+        }
+
+        if(storage.entities.count == storage.entities.capacity)
+        {
+            storage.entities.Grow(m_wAllocator);
+        }
+
+        storage.entities.Add(eId);
+        storage.index.PushBack(eId, slot);
+
+        if(!ti.HasData())
+        {
+            return nullptr;
+        }
+
+        void* data = storage.GetData(slot);
+
+        if(ti.hook.ctor)
+        {
+            ti.hook.ctor(data);
+        }
+        else
+        {
+            std::memset(data, 0, ti.size);
+        }
+
+        return data;
+    }
+
+    void World::RemoveSparse(SparseStorage& storage, EntityId eId)
+    {
+        uint32_t* slotPtr = storage.TryGetSlot(eId);
+        assert(slotPtr && "Entity does not have the component!");
+
+        uint32_t slot = *slotPtr;
+        uint32_t backSlot = storage.GetCount() - 1;
+        TypeInfo& ti = *storage.typeInfo;
+
+        if(ti.HasData())
+        {
+            if(ti.hook.dtor)
+            {
+                ti.hook.dtor(storage.GetData(slot));
+            }
+
+            if(slot != backSlot)
+            {
+                MoveColumnRange(ti, storage.GetData(slot), storage.GetData(backSlot), 1);
+            }
+        }
+
+        if(slot != backSlot)
+        {
+            EntityId backId = storage.entities.store[backSlot];
+            storage.entities.store[slot] = backId;
+            *storage.TryGetSlot(backId) = slot;
+        }
+
+        --storage.entities.count;
+        storage.index.Remove(eId);
+    }
+
+    void World::GrowSparseStorage(SparseStorage& storage)
+    {
+        TypeInfo& ti = *storage.typeInfo;
+
+        //reserved on first use, tags never get an arena
+        if(!storage.data)
+        {
+            storage.arena.Init();
+        }
+
+        storage.arena.Commit(CAST(ti.size, uint64_t) * (storage.capacity + 1));
+
+        storage.data = storage.arena.GetData();
+        storage.capacity = CAST(storage.arena.GetCommitted() / ti.size, uint32_t);
+    }
+
+    void World::MergeCommandBuffers()
+    {
+        m_mergedCommands.count = 0;
+
+        for(uint32_t bIdx = 0; bIdx < m_commandBufferCount; bIdx++)
+        {
+            CommandBuffer& cb = m_commandBuffers[bIdx];
+            Command* commands = cb.GetCommands();
+
+            for(uint32_t i = 0; i < cb.GetCount(); i++)
+            {
+                if(m_mergedCommands.count == m_mergedCommands.capacity)
+                {
+                    m_mergedCommands.Grow(m_wAllocator);
+                }
+
+                m_mergedCommands.Add(commands[i]);
+            }
+        }
+
+        //stable keeps the recorded order of every entity, buffers are already in thread order
+        std::stable_sort(m_mergedCommands.store, m_mergedCommands.store + m_mergedCommands.count,
+                         [](const Command& a, const Command& b)
+                         {
+                             return a.entity < b.entity;
+                         });
+
+        uint32_t first = 0;
+
+        while(first < m_mergedCommands.count)
+        {
+            uint32_t last = first + 1;
+
+            while(last < m_mergedCommands.count &&
+                  m_mergedCommands.store[last].entity == m_mergedCommands.store[first].entity)
+            {
+                ++last;
+            }
+
+            MergeEntityCommands(m_mergedCommands.store + first, last - first);
+
+            first = last;
+        }
+
+        //one batch for every entity destroyed during the frame
+        if(m_deferredDestroys.count)
+        {
+            DestroyEntities(m_deferredDestroys.store, m_deferredDestroys.count);
+            m_deferredDestroys.count = 0;
+        }
+
+        //set data is destroyed on merge, the blocks can be reused
+        for(uint32_t bIdx = 0; bIdx < m_commandBufferCount; bIdx++)
+        {
+            m_commandBuffers[bIdx].Clear();
+        }
+
+        uint32_t deferredNextId = m_deferredNextId.load(std::memory_order_relaxed);
+
+        if(deferredNextId > m_nextFreeId)
+        {
+            m_nextFreeId = deferredNextId;
+        }
+    }
+
+    void World::DestroyCommandData(const Command* commands, uint32_t count)
+    {
+        for(uint32_t i = 0; i < count; i++)
+        {
+            if(commands[i].type != CommandType::Set)
+            {
+                continue;
+            }
+
+            TypeInfo& ti = *m_typeInfos[commands[i].id];
 
-        cTi->hook.onAdd();
+            if(ti.hook.dtor)
+            {
+                ti.hook.dtor(commands[i].data);
+            }
+        }
     }
 
-    void World::AddPair(EntityId eId, EntityId first, EntityId second)
+    void World::MergeEntityCommands(const Command* commands, uint32_t count)
     {
-        EntityId pairId = MakePair(first, second);
-        TypeInfo* pTi = m_typeInfos.GetValue(first);
+        EntityId eId = commands[0].entity;
 
-        if(!m_componentIndex.ContainsKey(pairId))
+        //create first, another thread may have recorded an add before the creation
+        for(uint32_t i = 0; i < count; i++)
         {
-            TypeInfo* ti = new (m_wAllocator.Alloc(sizeof(TypeInfo))) TypeInfo();
-            *ti = *pTi;
-            ti->flags |= FULL_PAIR;
-            ti->id = pairId;
+            if(commands[i].type == CommandType::CreateEntity)
+            {
+                uint32_t dense = m_entityIndex.PushBack(eId, EntityRecord{});
+                EntityRecord& newRecord = *m_entityIndex.GetPageData(eId);
+                newRecord.dense = dense;
 
-            TypeInfoBuilder<> builder{*ti, this};
-            char name[30];
+                break;
+            }
+        }
 
-            ///std::snprintf(name, 30, )
-            builder.Register("Child of");
+        //recorded through a stale handle, the slot may already hold a recycled entity
+        if(!m_entityIndex.IsAlive(eId))
+        {
+            DestroyCommandData(commands, count);
+            return;
+        }
+
+        EntityRecord* r = m_entityIndex.GetPageData(eId);
+
+        //the other commands are dropped, only the data of the sets is destroyed
+        for(uint32_t i = 0; i < count; i++)
+        {
+            if(commands[i].type != CommandType::DestroyEntity)
+            {
+                continue;
+            }
+
+            DestroyCommandData(commands, count);
+
+            if(m_deferredDestroys.count == m_deferredDestroys.capacity)
+            {
+                m_deferredDestroys.Grow(m_wAllocator);
+            }
+
+            m_deferredDestroys.Add(eId);
+
+            return;
+        }
+
+        Archetype* srcArchetype = r->archetype;
+        Archetype* destArchetype = srcArchetype;
+
+        //walk the edges, only the final archetype gets the entity
+        for(uint32_t i = 0; i < count; i++)
+        {
+            const Command& cmd = commands[i];
+
+            //applied in order right away, they do not take part in the move
+            bool isStructural = cmd.type == CommandType::AddComponent || cmd.type == CommandType::RemoveComponent;
+            SparseStorage* storage = isStructural ? GetSparseStorage(cmd.id) : nullptr;
+
+            if(storage)
+            {
+                if(cmd.type == CommandType::AddComponent && !storage->Has(eId))
+                {
+                    AddSparse(*storage, eId);
+                    Emit(EventType::OnAdd, cmd.id, eId, r->archetype);
+                }
+                else if(cmd.type == CommandType::RemoveComponent && storage->Has(eId))
+                {
+                    RemoveSparse(*storage, eId);
+                    Emit(EventType::OnRemove, cmd.id, eId, r->archetype);
+                }
+
+                continue;
+            }
+
+            if(cmd.type == CommandType::AddComponent)
+            {
+                bool isPair = HI_ENTITY_ID(cmd.id) != 0;
+
+                if(isPair)
+                {
+                    RegisterPair(LO_ENTITY_ID(cmd.id), HI_ENTITY_ID(cmd.id));
+                }
+
+                if(destArchetype && destArchetype->components.Has(cmd.id))
+                {
+                    continue;
+                }
+
+                TypeInfo* ti = m_typeInfos.GetValue(LO_ENTITY_ID(cmd.id));
+
+                if(isPair && ti->IsExclusive() && destArchetype &&
+                   destArchetype->components.HasPair(LO_ENTITY_ID(cmd.id)))
+                {
+                    continue;
+                }
+
+                destArchetype = GetOrCreateArchetype_Add(destArchetype, cmd.id);
+            }
+            else if(cmd.type == CommandType::RemoveComponent)
+            {
+                if(!destArchetype || !destArchetype->components.Has(cmd.id))
+                {
+                    continue;
+                }
+
+                destArchetype = GetOrCreateArchetype_Remove(destArchetype, cmd.id);
+            }
+        }
+
+        if(destArchetype != srcArchetype)
+        {
+            MoveArchetype(eId, *r, destArchetype);
+
+            if(destArchetype)
+            {
+                for(uint32_t i = 0; i < destArchetype->components.count; i++)
+                {
+                    EntityId cId = destArchetype->components.idArr[i];
+
+                    if(srcArchetype && srcArchetype->components.Has(cId))
+                    {
+                        continue;
+                    }
+
+                    if(LO_ENTITY_ID(cId) == DependOnId && HI_ENTITY_ID(cId) != 0)
+                    {
+                        m_isScheduleDirty = true;
+                    }
+
+                    Emit(EventType::OnAdd, cId, eId, destArchetype);
+                }
+            }
+
+            if(srcArchetype)
+            {
+                for(uint32_t i = 0; i < srcArchetype->components.count; i++)
+                {
+                    EntityId cId = srcArchetype->components.idArr[i];
+
+                    if(destArchetype && destArchetype->components.Has(cId))
+                    {
+                        continue;
+                    }
+
+                    if(LO_ENTITY_ID(cId) == DependOnId && HI_ENTITY_ID(cId) != 0)
+                    {
+                        m_isScheduleDirty = true;
+                    }
+
+                    Emit(EventType::OnRemove, cId, eId, srcArchetype);
+                }
+            }
+        }
+
+        for(uint32_t i = 0; i < count; i++)
+        {
+            const Command& cmd = commands[i];
+
+            if(cmd.type != CommandType::Set)
+            {
+                continue;
+            }
+
+            SparseStorage* storage = GetSparseStorage(cmd.id);
+
+            //a later remove wins over the set
+            if(storage ? storage->Has(eId) : destArchetype && destArchetype->components.Has(cmd.id))
+            {
+                Set(eId, cmd.id, cmd.data);
+            }
+
+            TypeInfo& ti = *m_typeInfos[cmd.id];
+
+            if(ti.hook.dtor)
+            {
+                ti.hook.dtor(cmd.data);
+            }
+        }
+
+        //bits only exist in the final archetype, a toggle removed by the same merge drops them
+        for(uint32_t i = 0; i < count; i++)
+        {
+            const Command& cmd = commands[i];
+
+            if(cmd.type != CommandType::EnableComponent && cmd.type != CommandType::DisableComponent)
+            {
+                continue;
+            }
+
+            int32_t toggleIdx = destArchetype ? destArchetype->GetToggleIndex(cmd.id) : -1;
+
+            if(toggleIdx != -1)
+            {
+                destArchetype->SetEnabled(toggleIdx, r->row, cmd.type == CommandType::EnableComponent);
+            }
+        }
+    }
+
+    void World::Observe(EventType type, EntityId cId, ObserverCallback callback, void* ctx)
+    {
+        assert(callback);
+
+        EventBuffer& buffer = GetOrCreateEventBuffer(type, cId);
+
+        if(buffer.observers.count == buffer.observers.capacity)
+        {
+            buffer.observers.Grow(m_wAllocator);
+        }
+
+        buffer.observers.Add(Observer{callback, nullptr, ctx});
+    }
+
+    void World::Observe(EventType type, Query* query, ObserverCallback callback, void* ctx)
+    {
+        assert(callback);
+        assert(query);
+
+        if(m_queryEventBuffers.count == m_queryEventBuffers.capacity)
+        {
+            m_queryEventBuffers.Grow(m_wAllocator);
+        }
+
+        QueryEventBuffer queryBuffer;
+        queryBuffer.observer = Observer{callback, query, ctx};
+        queryBuffer.entities.Init(m_wAllocator);
+
+        m_queryEventBuffers.Add(queryBuffer);
+
+        //every term feeds the same buffer
+        for(uint32_t idx = 0; idx < query->terms.count; idx++)
+        {
+            EventBuffer& buffer = GetOrCreateEventBuffer(type, query->terms.idArr[idx]);
+
+            if(buffer.queryBuffers.count == buffer.queryBuffers.capacity)
+            {
+                buffer.queryBuffers.Grow(m_wAllocator);
+            }
+
+            buffer.queryBuffers.Add(m_queryEventBuffers.count - 1);
+        }
+    }
+
+    EventBuffer& World::GetOrCreateEventBuffer(EventType type, EntityId cId)
+    {
+        HashMap<EntityId, uint32_t>& index = m_eventBufferIndex[CAST(type, uint32_t)];
+
+        if(uint32_t* bIdx = index.TryGetValue(cId))
+        {
+            return m_eventBuffers.store[*bIdx];
+        }
+
+        if(m_eventBuffers.count == m_eventBuffers.capacity)
+        {
+            m_eventBuffers.Grow(m_wAllocator);
+        }
+
+        EventBuffer buffer;
+        buffer.component = cId;
+        buffer.type = type;
+        buffer.entities.Init(m_wAllocator);
+        buffer.observers.Init(m_wAllocator);
+        buffer.queryBuffers.Init(m_wAllocator);
+
+        m_eventBuffers.Add(buffer);
+        index.Insert(cId, m_eventBuffers.count - 1);
+
+        return m_eventBuffers.store[m_eventBuffers.count - 1];
+    }
+
+    //entity ids are contiguous inside a chunk
+    static void AppendRowEntities(WorldAllocator& wAllocator, Store<EntityId>& entities,
+                                  Archetype& archetype, uint32_t firstRow, uint32_t count)
+    {
+        while(entities.capacity < entities.count + count)
+        {
+            entities.Grow(wAllocator);
+        }
+
+        uint32_t lastRow = firstRow + count;
+
+        for(uint32_t row = firstRow; row < lastRow;)
+        {
+            uint32_t chunkRow = archetype.GetChunkRow(row);
+            uint32_t spanCount = std::min(archetype.GetChunkCapacity() - chunkRow, lastRow - row);
+
+            std::memcpy(entities.store + entities.count,
+                        archetype.GetChunkEntities(archetype.GetChunkIndex(row)) + chunkRow,
+                        sizeof(EntityId) * spanCount);
+
+            entities.count += spanCount;
+            row += spanCount;
+        }
+    }
+
+    void World::Emit(EventType type, EntityId cId, EntityId eId, Archetype* archetype)
+    {
+        if(m_eventBuffers.count == 0)
+        {
+            return;
+        }
+
+        uint32_t* bIdx = m_eventBufferIndex[CAST(type, uint32_t)].TryGetValue(cId);
+
+        if(!bIdx)
+        {
+            return;
+        }
+
+        EventBuffer& buffer = m_eventBuffers.store[*bIdx];
+
+        if(buffer.observers.count)
+        {
+            if(buffer.entities.count == buffer.entities.capacity)
+            {
+                buffer.entities.Grow(m_wAllocator);
+            }
+
+            buffer.entities.Add(eId);
+        }
+
+        for(uint32_t qIdx = 0; qIdx < buffer.queryBuffers.count; qIdx++)
+        {
+            QueryEventBuffer& queryBuffer = m_queryEventBuffers.store[buffer.queryBuffers.store[qIdx]];
+
+            if(!IsObservedBy(queryBuffer.observer.query, cId, eId, archetype))
+            {
+                continue;
+            }
+
+            if(queryBuffer.entities.count == queryBuffer.entities.capacity)
+            {
+                queryBuffer.entities.Grow(m_wAllocator);
+            }
+
+            queryBuffer.entities.Add(eId);
+        }
+    }
+
+    void World::EmitRows(EventType type, EntityId cId, Archetype& archetype, uint32_t firstRow, uint32_t count)
+    {
+        if(m_eventBuffers.count == 0 || count == 0)
+        {
+            return;
+        }
+
+        uint32_t* bIdx = m_eventBufferIndex[CAST(type, uint32_t)].TryGetValue(cId);
+
+        if(!bIdx)
+        {
+            return;
+        }
+
+        EventBuffer& buffer = m_eventBuffers.store[*bIdx];
+
+        if(buffer.observers.count)
+        {
+            AppendRowEntities(m_wAllocator, buffer.entities, archetype, firstRow, count);
+        }
+
+        for(uint32_t qIdx = 0; qIdx < buffer.queryBuffers.count; qIdx++)
+        {
+            QueryEventBuffer& queryBuffer = m_queryEventBuffers.store[buffer.queryBuffers.store[qIdx]];
+            Query* query = queryBuffer.observer.query;
+
+            if(!query->Match(&archetype))
+            {
+                continue;
+            }
+
+            //all rows share the archetype, only sparse terms are tested per entity
+            if(query->sparseTermCount == 0)
+            {
+                AppendRowEntities(m_wAllocator, queryBuffer.entities, archetype, firstRow, count);
+                continue;
+            }
+
+            for(uint32_t row = firstRow; row < firstRow + count; row++)
+            {
+                EntityId eId = archetype.GetEntity(row);
+
+                if(!IsObservedBy(query, cId, eId, &archetype))
+                {
+                    continue;
+                }
+
+                if(queryBuffer.entities.count == queryBuffer.entities.capacity)
+                {
+                    queryBuffer.entities.Grow(m_wAllocator);
+                }
+
+                queryBuffer.entities.Add(eId);
+            }
         }
+    }
+
+    void World::FlushEvents()
+    {
+        assert(!m_isDefered && "Can not flush events while progressing!");
+
+        //events emitted by the observers are picked up by the running flush
+        if(m_isFlushing)
+        {
+            return;
+        }
+
+        m_isFlushing = true;
+
+        bool hasEvents = true;
+
+        while(hasEvents)
+        {
+            hasEvents = false;
+
+            //observers can create buffers, the store is indexed again after every call
+            for(uint32_t bIdx = 0; bIdx < m_eventBuffers.count; bIdx++)
+            {
+                if(m_eventBuffers.store[bIdx].entities.count == 0)
+                {
+                    continue;
+                }
 
-        EntityRecord* r = m_entityIndex.GetPageData(eId);
+                hasEvents = true;
 
-        assert(r);
-        assert(!r->archetype->components.Has(pairId));
+                //new events of this buffer go to the emptied store
+                std::swap(m_eventBuffers.store[bIdx].entities, m_flushedEvents);
+                m_eventBuffers.store[bIdx].entities.count = 0;
 
-        if(pTi->IsExclusive())
-        {
-            if(r->archetype->components.HasPair(first))
-            {
-                return;
+                EntityId cId = m_eventBuffers.store[bIdx].component;
+
+                for(uint32_t oIdx = 0; oIdx < m_eventBuffers.store[bIdx].observers.count; oIdx++)
+                {
+                    Observer observer = m_eventBuffers.store[bIdx].observers.store[oIdx];
+
+                    observer.callback(this, cId, m_flushedEvents.store, m_flushedEvents.count, observer.ctx);
+                }
             }
-        }
 
-        Archetype* destArchetype = GetOrCreateArchetype_Add(r->archetype, pairId);
+            for(uint32_t qIdx = 0; qIdx < m_queryEventBuffers.count; qIdx++)
+            {
+                if(m_queryEventBuffers.store[qIdx].entities.count == 0)
+                {
+                    continue;
+                }
 
-        MoveArchetype_Add(eId, *r, destArchetype);
+                hasEvents = true;
 
-        pTi->hook.onAdd();
-    }
+                std::swap(m_queryEventBuffers.store[qIdx].entities, m_flushedEvents);
+                m_queryEventBuffers.store[qIdx].entities.count = 0;
 
-    void World::AddTag(EntityId eId, EntityId cId)
-    {
-        EntityRecord* r = m_entityIndex.GetPageData(eId);
+                //one change can hit several terms of the query
+                EntityId* first = m_flushedEvents.store;
+                std::sort(first, first + m_flushedEvents.count);
+                uint32_t count = CAST(std::unique(first, first + m_flushedEvents.count) - first, uint32_t);
 
-        assert(r);
+                Observer observer = m_queryEventBuffers.store[qIdx].observer;
 
-        TypeInfo* pti = m_typeInfos.GetValue(cId);
+                observer.callback(this, 0, first, count, observer.ctx);
+            }
+        }
 
-        assert(!r->archetype->components.Has(cId));
+        m_isFlushing = false;
+    }
 
-        if(pti->IsExclusive())
+    bool World::IsObservedBy(Query* query, EntityId cId, EntityId eId, Archetype* archetype)
+    {
+        if(!archetype || !query->Match(archetype))
         {
-            assert(!r->archetype->components.HasPair(cId));
+            return false;
         }
 
-        Archetype* destArchetype = GetOrCreateArchetype_Add(r->archetype, cId);
+        for(uint32_t idx = 0; idx < query->terms.count && query->sparseTermCount; idx++)
+        {
+            if(!query->sparseTerms[idx] || query->terms.idArr[idx] == cId)
+            {
+                continue;
+            }
 
-        MoveArchetype_Add(eId, *r, destArchetype);
+            if(!query->sparseTerms[idx]->Has(eId))
+            {
+                return false;
+            }
+        }
 
-        pti->hook.onAdd();
+        return true;
     }
 
-    void World::RemoveComponent(EntityId eId, EntityId cId)
+    Query* World::GetOrCreateQuery(const EntityId* ids, uint32_t count)
     {
-        EntityRecord* r = m_entityIndex.GetPageData(eId);
-
-        assert(r);
-        assert(r->archetype);
-        Archetype* srcArchetype = r->archetype;
-        int32_t s = srcArchetype->components.Search(cId);
+        ComponentSet key;
+        key.idArr = const_cast<EntityId*>(ids);
+        key.count = count;
 
-        assert(s != -1);
+        if(m_queryCache.ContainsKey(key))
+        {
+            return m_queryCache[key];
+        }
 
-        Archetype* destArchetype = GetOrCreateArchetype_Remove(srcArchetype, cId);
+        Query* query = CreateQuery(ids, count);
 
-        MoveArchetype_Remove(eId, *r, destArchetype);
+        m_queryCache.Insert(query->terms, query);
 
-        TypeInfo& ti = *m_typeInfos[cId];
-        ti.hook.onRemove();
+        return query;
     }
 
-    void World::Set(EntityId eId, EntityId cId, void* data)
+    Query* World::CreateQuery(const EntityId* ids, uint32_t count)
     {
-        EntityRecord* r = m_entityIndex.GetPageData(eId);
-        assert(r);
-        assert(r->archetype);
-        assert(r->dense);
-
-        int32_t idx = r->archetype->components.Search(cId);
-        int32_t colIdx = r->archetype->componentMap[idx];
-        assert(colIdx != -1);
+        assert(count && "Query has no term!");
+        assert(count <= MaxQueryTermCount && "Query has too many terms!");
+
+        Query* query = new (m_wAllocator.Alloc(sizeof(Query))) Query();
+        query->terms.Alloc(m_wAllocator, count);
+        query->terms.count = count;
+        std::memcpy(query->terms.idArr, ids, count * sizeof(EntityId));
+        query->archetypes.Init(m_wAllocator);
+        query->columns.Init(m_wAllocator);
+        query->toggles.Init(m_wAllocator);
+        query->cascadeOrder.Init(m_wAllocator);
+        query->cascadeVersion = 0;
+
+        //terms match on their LO id, pairs through the bit of their relation
+        query->signature.Clear();
+        query->hasSignature = true;
+        query->sparseTermCount = 0;
+        query->targetTermCount = 0;
+        query->pairTermCount = 0;
+
+        for(uint32_t idx = 0; idx < count; idx++)
+        {
+            bool isTargetTerm = LO_ENTITY_ID(ids[idx]) == WildcardId && HI_ENTITY_ID(ids[idx]) != 0;
+            bool isPairTerm = !isTargetTerm && HI_ENTITY_ID(ids[idx]) != 0 && HI_ENTITY_ID(ids[idx]) != WildcardId;
 
-        Column& col = r->archetype->columns[colIdx];
-        TypeInfo& ti = *col.typeInfo;
+            query->targetTerms[idx] = isTargetTerm ? HI_ENTITY_ID(ids[idx]) : 0;
+            query->targetTermCount += isTargetTerm;
+            query->pairTerms[idx] = isPairTerm ? ids[idx] : 0;
+            query->pairTermCount += isPairTerm;
+        }
 
-        void* component = OFFSET_ELEMENT(col.data, ti.size ,r->row);
+        //first archetype term, its record holds every archetype the query can match
+        int32_t driveIdx = -1;
 
-        if (ti.hook.moveCtor)
-        {
-            ti.hook.moveCtor(component, data);
-        }
-        else if (ti.hook.copyCtor)
+        for(uint32_t idx = 0; idx < count; idx++)
         {
-            ti.hook.copyCtor(component, data);
+            query->sparseTerms[idx] = GetSparseStorage(ids[idx]);
+
+            if(query->sparseTerms[idx])
+            {
+                ++query->sparseTermCount;
+            }
+            else if(driveIdx == -1)
+            {
+                driveIdx = idx;
+            }
         }
-        else
+
+        assert(driveIdx != -1 && "Query needs at least one archetype term!");
+
+        for(uint32_t idx = 0; idx < count; idx++)
         {
-            std::memcpy(component, data, ti.size);
-        }
-    }
+            //targets are not part of the signature, they are searched in Match
+            if(query->sparseTerms[idx] || query->targetTerms[idx])
+            {
+                continue;
+            }
 
-    void World::Set(EntityId eId, EntityId cId, const void* data)
-    {
-        EntityRecord* r = m_entityIndex.GetPageData(eId);
-        assert(r);
-        assert(r->archetype);
-        assert(r->dense);
+            TypeInfo** ti = m_typeInfos.TryGetValue(LO_ENTITY_ID(ids[idx]));
 
-        int32_t idx = r->archetype->components.Search(cId);
-        int32_t colIdx = r->archetype->componentMap[idx];
-        assert(colIdx != -1);
+            if(!ti || (*ti)->denseIndex == InvalidDenseIndex)
+            {
+                query->hasSignature = false;
+                break;
+            }
 
-        Column& col = r->archetype->columns[colIdx];
-        TypeInfo& ti = *col.typeInfo;
+            query->signature.Set((*ti)->denseIndex);
+        }
 
-        void* component = OFFSET_ELEMENT(col.data, ti.size ,r->row);
+        //every matching archetype is stored in the term's record, pairs included
+        ComponentRecord* cr = GetTermRecord(ids[driveIdx]);
 
-        if (ti.hook.copyCtor)
+        for(uint32_t aIdx = 0; cr && aIdx < cr->archetypeStore.count; aIdx++)
         {
-            ti.hook.copyCtor(component, data);
+            Archetype* archetype = cr->archetypeStore.store[aIdx];
+            assert(archetype);
+
+            if(query->Match(archetype))
+            {
+                query->AddArchetype(m_wAllocator, archetype);
+            }
         }
-        else
+
+        if(m_queryStore.capacity == m_queryStore.count)
         {
-            std::memcpy(component, data, ti.size);
+            m_queryStore.Grow(m_wAllocator);
         }
+
+        m_queryStore.Add(query);
+
+        return query;
     }
 
-    void* World::Get(EntityId eId, EntityId cId)
+    ComponentRecord& World::GetOrCreateTargetRecord(EntityId target)
     {
-        EntityRecord* r = m_entityIndex.GetPageData(eId);
-        assert(r);
-        assert(r->archetype);
-        assert(r->dense);
+        EntityId id = AnyRelation(target);
+        ComponentRecord* cr = m_componentIndex.TryGetValue(id);
 
-        int32_t idx = r->archetype->components.Search(cId);
-        int32_t colIdx = r->archetype->componentMap[idx];
-        assert(colIdx != -1);
+        if(cr)
+        {
+            return *cr;
+        }
 
-        Column& col = r->archetype->columns[colIdx];
-        TypeInfo& ti = *col.typeInfo;
+        ComponentRecord tCr;
+        tCr.id = id;
+        tCr.typeInfo = m_typeInfos.GetValue(WildcardId);
+#ifdef ECS_DEBUG
+        std::snprintf(tCr.name, 16, "* %u", LO_ENTITY_ID(target));
+#endif
+        tCr.archetypeStore.Init(m_wAllocator);
 
-        void* component = OFFSET_ELEMENT(col.data, ti.size ,r->row);
+        m_componentIndex.Insert(id, std::move(tCr));
 
-        return component;    
+        return m_componentIndex.GetValue(AnyRelation(target));
     }
-    
-    void World::GrowArchetype(Archetype& archetype)
+
+    ComponentRecord* World::GetTermRecord(EntityId term)
     {
-        uint32_t newCapacity = archetype.capacity * 2;
+        //(relation, *) archetypes are all in the relation's record
+        if(HI_ENTITY_ID(term) == WildcardId)
+        {
+            return m_componentIndex.TryGetValue(LO_ENTITY_ID(term));
+        }
 
-        //grow entities
-        EntityId* newEntities =
-            PTR_CAST(m_wAllocator.Alloc(sizeof(EntityId) * newCapacity), EntityId);
+        return m_componentIndex.TryGetValue(term);
+    }
 
-        std::memcpy(newEntities, archetype.entities, sizeof(EntityId) * archetype.capacity);
-        m_wAllocator.Free(sizeof(EntityId) * archetype.capacity, archetype.entities);
+    void World::MatchQueries(Archetype* archetype)
+    {
+        for(uint32_t qIdx = 0; qIdx < m_queryStore.count; qIdx++)
+        {
+            Query* query = m_queryStore.store[qIdx];
 
-        archetype.entities = newEntities;
+            if(query->Match(archetype))
+            {
+                query->AddArchetype(m_wAllocator, archetype);
+            }
+        }
+    }
 
-        //grow column data
-        for(uint32_t idx = 0; idx < archetype.columnCount; idx++)
+    void World::RunQuery(Query* query, SystemCallback& sc)
+    {
+        if(sc.flags & SYSTEM_CASCADE)
         {
-            Column& col = archetype.columns[idx];
-            TypeInfo* ti = col.typeInfo;
-            void* newColData = m_wAllocator.Alloc(ti->size * newCapacity);
+            SortCascadeOrder(query);
 
-            if(ti->hook.moveCtor || ti->hook.copyCtor)
+            for(uint32_t oIdx = 0; oIdx < query->cascadeOrder.count; oIdx++)
             {
-                for(uint32_t row = 0; row < archetype.count; row++)
+                uint32_t aIdx = query->cascadeOrder.store[oIdx];
+                Archetype* archetype = query->archetypes.store[aIdx];
+
+                for(uint32_t chunkIdx = 0; chunkIdx < archetype->chunks.count; chunkIdx++)
                 {
-                    void* dest = OFFSET(newColData, ti->size * row);
-                    void* src = OFFSET(col.data, ti->size * row);
+                    RunQueryChunk(query, sc, aIdx, chunkIdx);
+                }
+            }
 
-                    if(ti->hook.moveCtor)
-                    {
-                        ti->hook.moveCtor(dest, src);
-                    }
-                    else
-                    {
-                        ti->hook.copyCtor(dest, src);
-                    }
+            return;
+        }
 
-                    if(ti->hook.dtor)
-                    {
-                        ti->hook.dtor(src);
-                    }
-                }
+        for(uint32_t aIdx = 0; aIdx < query->archetypes.count; aIdx++)
+        {
+            Archetype* archetype = query->archetypes.store[aIdx];
+
+            for(uint32_t chunkIdx = 0; chunkIdx < archetype->chunks.count; chunkIdx++)
+            {
+                RunQueryChunk(query, sc, aIdx, chunkIdx);
             }
-            else
+        }
+    }
+
+    //sparse terms are looked up per row, false when the entity misses one of them
+    static bool JoinSparseTerms(Query* query, EntityId eId, void** componentsData)
+    {
+        for(uint32_t idx = 0; idx < query->terms.count; idx++)
+        {
+            SparseStorage* storage = query->sparseTerms[idx];
+
+            if(!storage)
             {
-                std::memcpy(newColData, col.data, ti->size * archetype.count);
+                continue;
             }
 
-            m_wAllocator.Free(ti->size * archetype.capacity, col.data);
+            uint32_t* slot = storage->TryGetSlot(eId);
+
+            if(!slot)
+            {
+                return false;
+            }
 
-            col.data = newColData;
+            componentsData[idx] = storage->data ? storage->GetData(*slot) : nullptr;
         }
 
-        archetype.capacity = newCapacity;
+        return true;
     }
 
-    void World::SwapBack(EntityRecord& r)
+    void World::RunQueryChunk(Query* query, SystemCallback& sc, uint32_t matchIdx, uint32_t chunkIdx)
     {
-        assert(r.archetype);
-        assert(r.dense);
-
-        Archetype& archetype = *r.archetype;
+        Archetype* archetype = query->archetypes.store[matchIdx];
+        uint32_t chunkCount = archetype->GetChunkCount(chunkIdx);
 
-        if(archetype.count == 0 || (archetype.count == r.row + 1))
+        if(chunkCount == 0)
         {
             return;
         }
 
-        EntityId swapId = archetype.entities[r.row];
-        EntityId backId = archetype.entities[archetype.count - 1];
+        int32_t* columns = query->GetColumns(matchIdx);
+        uint32_t termCount = query->terms.count;
 
-        EntityRecord* backRecord = m_entityIndex.GetPageData(backId);
-        assert(backRecord);
+        //an empty sparse term can not join any row
+        for(uint32_t idx = 0; idx < termCount && query->sparseTermCount; idx++)
+        {
+            if(query->sparseTerms[idx] && query->sparseTerms[idx]->GetCount() == 0)
+            {
+                return;
+            }
+        }
 
-        archetype.entities[r.row] = backId;
-        archetype.entities[archetype.count - 1] = swapId;
+        uint32_t* ticks = archetype->GetChunkTicks(chunkIdx);
 
-        for(uint32_t i = 0; i < r.archetype->components.count; i++)
+        //a chunk only runs when one of the read terms was written after the last run,
+        //every chunk runs the first time
+        if((sc.flags & SYSTEM_CHANGED) && sc.lastRunTick != 0)
         {
-            Column& col = r.archetype->columns[i];
-            TypeInfo& ti = *col.typeInfo;
-            void* swap = OFFSET(col.data, ti.size * r.row);
-            void* back = OFFSET(col.data, ti.size * (archetype.count - 1));
+            bool isChanged = false;
 
-            void* temp = m_wAllocator.Alloc(ti.size);
+            //without read only terms the mutable ones are watched, the system's own writes are not newer
+            uint32_t watchMask = sc.readMask ? sc.readMask : sc.writeMask;
 
-            if(ti.hook.moveCtor)
+            for(uint32_t idx = 0; idx < termCount && !isChanged; idx++)
             {
-                ti.hook.moveCtor(temp, swap);
-                ti.hook.moveCtor(swap, back);
-                ti.hook.moveCtor(back, temp);
-            }
-            else if(ti.hook.copyCtor)
-            {
-                ti.hook.copyCtor(temp, swap);
-                ti.hook.copyCtor(swap, back);
-                ti.hook.copyCtor(back, temp);
+                if(!(watchMask & (1u << idx)))
+                {
+                    continue;
+                }
+
+                //sparse terms keep no tick, they always count as changed
+                isChanged = query->sparseTerms[idx] ||
+                            (columns[idx] != -1 && ticks[columns[idx]] > sc.lastRunTick);
             }
-            else
+
+            if(!isChanged)
             {
-                std::memcpy(temp, swap, ti.size);
-                std::memcpy(swap, back, ti.size);
-                std::memcpy(back, temp, ti.size);
+                return;
             }
+        }
 
-            if(ti.hook.dtor)
+        //mutable arguments count as a write to the whole chunk column
+        for(uint32_t idx = 0; idx < termCount; idx++)
+        {
+            if((sc.writeMask & (1u << idx)) && columns[idx] != -1)
             {
-                ti.hook.dtor(temp);
+                ticks[columns[idx]] = m_changeTick;
             }
-
-            m_wAllocator.Free(ti.size, temp);
         }
 
-        backRecord->row = r.row;
-        r.row = archetype.count - 1;
-    }
-
-    Archetype* World::CreateArchetype(ComponentSet&& componentSet)
-    {
-        ArchetypeId id = GetArchetypeId();
-        Archetype archetype;
-        archetype.id = id;
-        archetype.count = 0;
-        archetype.capacity = DefaultArchetypeCapacity;
-        archetype.components = componentSet;
-        archetype.addEdges.Init(&m_wAllocator, DefaultArchetypeCapacity);
-        archetype.removeEdges.Init(&m_wAllocator, DefaultArchetypeCapacity);
-
-        archetype.columns =
-            PTR_CAST(m_wAllocator.Alloc(sizeof(Column) * componentSet.count), Column);
-        archetype.entities =
-            PTR_CAST(m_wAllocator.Alloc(sizeof(EntityId) * DefaultArchetypeCapacity), EntityId);
-        archetype.componentMap =
-            PTR_CAST(m_wAllocator.Calloc(sizeof(int32_t) * componentSet.count * 2), int32_t);
+        //column base pointers and strides only depend on the chunk
+        void* componentsData[MaxQueryTermCount];
+        uint32_t strides[MaxQueryTermCount];
 
-        uint32_t dataColCounter = 0;
-        for(uint32_t idx = 0; idx < componentSet.count; idx++)
+        for(uint32_t idx = 0; idx < termCount; idx++)
         {
-            TypeInfo* ti = m_typeInfos[componentSet.idArr[idx]];
-            if(ti->HasData())
-            {
-                archetype.columns[dataColCounter].typeInfo = ti;
-                archetype.columns[dataColCounter].data =
-                    m_wAllocator.Alloc(ti->size * DefaultArchetypeCapacity);
+            int32_t colIdx = columns[idx];
 
-                archetype.componentMap[idx] = dataColCounter;
-                archetype.componentMap[componentSet.count + dataColCounter] = idx;
-                ++dataColCounter;
+            if(colIdx == -1)
+            {
+                componentsData[idx] = nullptr;
+                strides[idx] = 0;
             }
             else
             {
-                archetype.componentMap[idx] = -1;
+                componentsData[idx] = archetype->GetChunkColumn(chunkIdx, colIdx);
+                strides[idx] = archetype->columns[colIdx].typeInfo->size;
             }
         }
-        archetype.columnCount = dataColCounter;
-
-        m_archetypes.PushBack(id, std::move(archetype));
-        Archetype* rArchetype = m_archetypes.GetPageData(id);
-
-        //NOTE: Test this
-        for(uint32_t idx = 0; idx < componentSet.count; idx++)
-        {
-            ComponentRecord& cr = m_componentIndex[componentSet.idArr[idx]];
 
-            //union pair
-            if(cr.typeInfo->IsFullPair())
-            {
-                ComponentRecord& pCr = m_componentIndex[LO_ENTITY_ID(componentSet.idArr[idx])];
+        QueryIterator it;
+        it.archetype = archetype;
+        it.world = this;
+        it.row = chunkIdx << archetype->chunkRowShift;
 
-                if(pCr.archetypeStore.count == pCr.archetypeStore.capacity)
-                {
-                    pCr.archetypeStore.Grow(m_wAllocator);
-                }
+        EntityId* entities = archetype->GetChunkEntities(chunkIdx);
 
-                pCr.archetypeStore.store[pCr.archetypeStore.count] = rArchetype;
-                ++pCr.archetypeStore.count;
-            }
+        //enable bits of the toggled terms in this chunk
+        const uint64_t* toggleWords[MaxQueryTermCount];
+        uint32_t toggleCount = 0;
+        int32_t* toggles = query->GetToggles(matchIdx);
 
-            if(cr.archetypeStore.count == cr.archetypeStore.capacity)
+        for(uint32_t idx = 0; idx < termCount; idx++)
+        {
+            if(toggles[idx] != -1)
             {
-                cr.archetypeStore.Grow(m_wAllocator);
+                toggleWords[toggleCount] = archetype->GetChunkToggle(chunkIdx, toggles[idx]);
+                ++toggleCount;
             }
-
-            cr.archetypeStore.store[cr.archetypeStore.count] = rArchetype;
-            ++cr.archetypeStore.count;
         }
 
-        m_mappedArchetype.Insert(componentSet, rArchetype);
-
-        return rArchetype;
-    }
-
-    Archetype* World::GetArchetype(const ComponentSet& componentSet)
-    {
-        if(m_mappedArchetype.ContainsKey(componentSet))
+        //SoA systems see every row of the chunk through their views
+        if(sc.isChunk)
         {
-            return m_mappedArchetype[componentSet];
-        }
+            assert(query->sparseTermCount == 0 && toggleCount == 0 &&
+                   "SoA systems can not join sparse or toggled terms!");
 
-        return nullptr;
-    }
+            sc.Execute(&it, componentsData);
 
-    Archetype* World::GetOrCreateArchetype_Add(Archetype* src, EntityId cId)
-    {
-        uint32_t srcCount = 0;
-        if(src)
-        {
-            srcCount = src->components.count;
+            return;
         }
 
-        Archetype* dest = nullptr;
-
-        //find or create edge
-        if(src)
+        if(toggleCount)
         {
-            if(src->addEdges.ContainsKey(cId))
-            {
-                dest = src->addEdges[cId];
-            }
-            else
+            void* rowData[MaxQueryTermCount];
+            uint32_t firstRow = it.row;
+
+            //64 rows per word, a word with every row disabled costs one AND
+            for(uint32_t wordIdx = 0; (wordIdx << 6) < chunkCount; wordIdx++)
             {
-                //CREATE EDEGE
-                uint32_t count = srcCount + 1;
+                uint64_t mask = toggleWords[0][wordIdx];
 
-                ComponentSet cs;
-                cs.Alloc(m_wAllocator, count);
-                std::memcpy(cs.idArr, src->components.idArr, srcCount * sizeof(EntityId));
-                cs.idArr[count - 1] = cId;
-                cs.count = count;
-                cs.Sort();
+                for(uint32_t t = 1; t < toggleCount; t++)
+                {
+                    mask &= toggleWords[t][wordIdx];
+                }
 
-                dest = GetArchetype(cs);
+                uint32_t rowsLeft = chunkCount - (wordIdx << 6);
 
-                if(!dest)
+                if(rowsLeft < 64)
                 {
-                    dest = CreateArchetype(std::move(cs));
+                    mask &= (1ULL << rowsLeft) - 1;
                 }
-                else
+
+                while(mask)
                 {
-                    m_wAllocator.Free(sizeof(EntityId) * cs.count, cs.idArr);
-                }
+                    uint32_t row = (wordIdx << 6) + CountTrailingZeros64(mask);
+                    mask &= mask - 1;
+
+                    for(uint32_t idx = 0; idx < termCount; idx++)
+                    {
+                        rowData[idx] = OFFSET(componentsData[idx], strides[idx] * row);
+                    }
+
+                    if(query->sparseTermCount && !JoinSparseTerms(query, entities[row], rowData))
+                    {
+                        continue;
+                    }
 
-                src->addEdges.Insert(cId, dest);
+                    it.row = firstRow + row;
+
+                    //EXECUTE
+                    sc.Execute(&it, rowData);
+                }
             }
+
+            return;
         }
-        else
-        {
-            ComponentSet cs;
-            cs.Alloc(m_wAllocator, 1);
-            cs.idArr[0] = cId;
-            cs.count = 1;
 
-            dest = GetArchetype(cs);
+        for(uint32_t row = 0; row < chunkCount; row++)
+        {
+            //sparse terms overwrite their entry, their stride stays 0
+            bool isJoined = query->sparseTermCount == 0 || JoinSparseTerms(query, entities[row], componentsData);
 
-            if(!dest)
+            //EXECUTE
+            if(isJoined)
             {
-                dest = CreateArchetype(std::move(cs));
+                sc.Execute(&it, componentsData);
             }
-            else
+
+            for(uint32_t idx = 0; idx < termCount; idx++)
             {
-                m_wAllocator.Free(sizeof(EntityId), cs.idArr);
+                componentsData[idx] = OFFSET(componentsData[idx], strides[idx]);
             }
+
+            ++it.row;
         }
+    }
 
-        assert(dest);
+    struct SystemJob
+    {
+        World* world;
+        SystemCallback* sc;
+        uint32_t matchIdx;
+        uint32_t chunkIdx;
+    };
 
-        return dest;
+    constexpr uint32_t SystemJobWholeQuery = UINT32_MAX;
+
+    static void RunSystemJob(void* data)
+    {
+        SystemJob* job = PTR_CAST(data, SystemJob);
+
+        if(job->matchIdx == SystemJobWholeQuery)
+        {
+            job->world->RunQuery(job->sc->query, *job->sc);
+        }
+        else
+        {
+            job->world->RunQueryChunk(job->sc->query, *job->sc, job->matchIdx, job->chunkIdx);
+        }
     }
 
-    Archetype* World::GetOrCreateArchetype_Remove(Archetype* src, EntityId cId)
+    //true when both terms can resolve to the same column, wildcards and bare relations cover every pair they match
+    static bool IsTermOverlap(EntityId first, EntityId sec)
     {
-        assert(src);
+        if(first == sec)
+        {
+            return true;
+        }
 
-        uint32_t srcCount = 0;
-        srcCount = src->components.count;
+        uint32_t firstRelation = LO_ENTITY_ID(first);
+        uint32_t secRelation = LO_ENTITY_ID(sec);
+        uint32_t firstTarget = HI_ENTITY_ID(first);
+        uint32_t secTarget = HI_ENTITY_ID(sec);
 
-        Archetype* dest = nullptr;
+        bool isAnyFirstTarget = firstTarget == WildcardId || firstTarget == 0;
+        bool isAnySecTarget = secTarget == WildcardId || secTarget == 0;
 
-        if(src->removeEdges.ContainsKey(cId))
+        if(firstRelation == secRelation && (isAnyFirstTarget || isAnySecTarget))
         {
-            dest = src->removeEdges[cId];
+            return true;
         }
-        else
+
+        if(firstTarget == secTarget && (firstRelation == WildcardId || secRelation == WildcardId))
         {
-            //CREATE EDEGE
-            uint32_t count = srcCount - 1;
-            
-            assert(count >= 0);
-            if(count == 0)
-            {
-                return nullptr;
-            }
-            else
-            {
-                ComponentSet cs;
-                cs.Alloc(m_wAllocator, count);
-                cs.count = count;
+            return true;
+        }
 
-                //TODO: Review this later
-                int32_t rIdx = src->components.Search(cId);
-                assert(rIdx != -1);
+        //(*, target) and (relation, *) share the (relation, target) pair
+        return (firstRelation == WildcardId && secTarget == WildcardId) ||
+               (secRelation == WildcardId && firstTarget == WildcardId);
+    }
 
-                std::memcpy(cs.idArr, src->components.idArr, rIdx * sizeof(EntityId));
-                std::memcpy(cs.idArr + rIdx, src->components.idArr + rIdx + 1, (count - rIdx - 1) * sizeof(EntityId));
-                cs.Sort();
+    bool World::IsSystemConflict(SystemCallback& first, SystemCallback& sec)
+    {
+        ComponentSet& firstTerms = first.query->terms;
+        ComponentSet& secTerms = sec.query->terms;
 
-                dest = GetArchetype(cs);
+        for(uint32_t fIdx = 0; fIdx < firstTerms.count; fIdx++)
+        {
+            bool firstWrite = first.writeMask & (1u << fIdx);
+            bool firstRead = first.readMask & (1u << fIdx);
 
-                if(!dest)
+            if(!firstWrite && !firstRead)
+            {
+                continue;
+            }
+
+            for(uint32_t sIdx = 0; sIdx < secTerms.count; sIdx++)
+            {
+                if(!IsTermOverlap(firstTerms.idArr[fIdx], secTerms.idArr[sIdx]))
                 {
-                    dest = CreateArchetype(std::move(cs));
+                    continue;
                 }
-                else
+
+                bool secWrite = sec.writeMask & (1u << sIdx);
+
+                //read/read is the only access that does not need ordering
+                if(firstWrite || secWrite)
                 {
-                    m_wAllocator.Free(sizeof(EntityId) * cs.count, cs.idArr);
+                    return true;
                 }
-
-                src->removeEdges.Insert(cId, dest);
             }
         }
 
-        return dest;
+        return false;
     }
 
-    void World::MoveArchetype_Add(EntityId eId, EntityRecord& r, Archetype* destArchetype)
+    bool World::IsSystemDependOn(SystemCallback& sc, SystemCallback& other)
     {
-        assert(destArchetype);
+        EntityRecord* r = m_entityIndex.GetPageData(sc.entity);
 
-        if(destArchetype->count == destArchetype->capacity)
+        if(!r || !r->archetype)
         {
-            GrowArchetype(*destArchetype);
+            return false;
         }
 
-        //empty entity
-        if(!r.archetype)
+        return r->archetype->components.Has(MakePair(DependOnId, other.entity));
+    }
+
+    void World::BuildSchedule()
+    {
+        uint32_t systemCount = m_systemStore.count;
+
+        m_schedule.count = 0;
+        m_scheduleStages.count = 0;
+
+        if(systemCount == 0)
         {
-            if(destArchetype->columnCount == 1)
-            {
-                TypeInfo& ti = *destArchetype->columns[0].typeInfo;
-                void* dataAddr = OFFSET(destArchetype->columns[0].data, destArchetype->count * ti.size);
-                ti.hook.ctor(dataAddr);
-            }
+            m_isScheduleDirty = false;
+            return;
         }
-        //at least 1 component
-        else
+
+        /*
+            Edge j -> i when a write conflicts with an earlier system j, keeping registration order,
+            or when i has (DependOn, j). Every system lands in the stage after its latest dependency
+        */
+        uint32_t* stages = PTR_CAST(m_wAllocator.Calloc(sizeof(uint32_t) * systemCount), uint32_t);
+        uint8_t* isResolved = PTR_CAST(m_wAllocator.Calloc(sizeof(uint8_t) * systemCount), uint8_t);
+
+        uint32_t resolvedCount = 0;
+        uint32_t stageCount = 0;
+
+        while(resolvedCount < systemCount)
         {
-            //SWAP BACK IN SRC ARCHETYPE
-            SwapBack(r);
+            bool progressed = false;
 
-            for(uint32_t i = 0; i < destArchetype->components.count; i++)
+            for(uint32_t i = 0; i < systemCount; i++)
             {
-                //skip no data tag and pair
-                int32_t destColIdx = destArchetype->componentMap[i];
-
-                if(destColIdx == -1)
+                if(isResolved[i])
                 {
                     continue;
                 }
 
-                Column& destCol = destArchetype->columns[destColIdx];
-                TypeInfo& ti = *destCol.typeInfo;
-
-                void* dest = OFFSET(destCol.data, ti.size * destArchetype->count);
+                SystemCallback& sc = m_systemStore.store[i];
+                uint32_t stage = 0;
+                bool isReady = true;
 
-                int32_t srcIndex = r.archetype->components.Search(destArchetype->components.idArr[i]);
-
-                if(srcIndex == -1)
+                for(uint32_t j = 0; j < systemCount && isReady; j++)
                 {
-                    ti.hook.ctor(dest);
-                }
-                else
-                {
-                    int32_t srcColIdx = r.archetype->componentMap[srcIndex];
-
-                    if(srcColIdx == -1)
+                    if(i == j)
                     {
-                        assert(0 && "Mismatch type");
+                        continue;
                     }
 
-                    Column& srcCol = r.archetype->columns[srcColIdx];
-                    void* src = OFFSET(srcCol.data, ti.size * r.row);
+                    SystemCallback& other = m_systemStore.store[j];
 
-                    if(ti.hook.moveCtor)
-                    {
-                        ti.hook.moveCtor(dest, src);
-                    }
-                    else if(ti.hook.copyCtor)
+                    if((j < i && IsSystemConflict(other, sc)) || IsSystemDependOn(sc, other))
                     {
-                        ti.hook.copyCtor(dest, src);
-                    }
-                    else
-                    {
-                        std::memcpy(dest, src, ti.size);
+                        if(!isResolved[j])
+                        {
+                            isReady = false;
+                        }
+                        else
+                        {
+                            stage = std::max(stage, stages[j] + 1);
+                        }
                     }
+                }
 
-                    if(ti.hook.dtor)
-                    {
-                        ti.hook.dtor(src);
-                    }
+                if(isReady)
+                {
+                    stages[i] = stage;
+                    isResolved[i] = 1;
+                    ++resolvedCount;
+                    stageCount = std::max(stageCount, stage + 1);
+                    progressed = true;
                 }
             }
 
-            --r.archetype->count;
-        }
-
-        destArchetype->entities[destArchetype->count] = eId;
-        r.archetype = destArchetype;
-        r.row = destArchetype->count;
-        ++destArchetype->count;
-    }
+            if(progressed)
+            {
+                continue;
+            }
 
-    void World::MoveArchetype_Remove(EntityId eId, EntityRecord& r, Archetype* destArchetype)
-    {
-        Archetype* srcArchetype = r.archetype;
-        SwapBack(r);
+            //DependOn cycle, the first unresolved system gets a stage of its own after every stage so far
+            //and the rest of the cycle orders after it, conflicting systems never share a stage
+            for(uint32_t i = 0; i < systemCount; i++)
+            {
+                if(!isResolved[i])
+                {
+                    stages[i] = stageCount++;
+                    isResolved[i] = 1;
+                    ++resolvedCount;
+                    break;
+                }
+            }
+        }
 
-        if(!destArchetype)
+        for(uint32_t stage = 0; stage < stageCount; stage++)
         {
-            if(srcArchetype->columnCount == 1 && srcArchetype->components.count == 1)
+            for(uint32_t i = 0; i < systemCount; i++)
             {
-                int32_t srcColIdx = srcArchetype->componentMap[0];
-                Column& srcCol = srcArchetype->columns[srcColIdx];
-                TypeInfo& ti = *srcCol.typeInfo;
+                if(stages[i] != stage)
+                {
+                    continue;
+                }
 
-                if(ti.HasData() && ti.hook.dtor)
+                if(m_schedule.count == m_schedule.capacity)
                 {
-                    void* src = OFFSET_ELEMENT(srcCol.data, ti.size, srcArchetype->count - 1);
-                    ti.hook.dtor(src);
+                    m_schedule.Grow(m_wAllocator);
                 }
 
-                r.row = 0;
-                --r.archetype->count;
-                r.archetype = destArchetype;
+                m_schedule.Add(i);
             }
-            else
+
+            if(m_scheduleStages.count == m_scheduleStages.capacity)
             {
-                assert(0);
+                m_scheduleStages.Grow(m_wAllocator);
             }
+
+            m_scheduleStages.Add(m_schedule.count);
         }
-        else
+
+        m_wAllocator.Free(sizeof(uint8_t) * systemCount, isResolved);
+        m_wAllocator.Free(sizeof(uint32_t) * systemCount, stages);
+
+        m_isScheduleDirty = false;
+    }
+
+    void World::RunScheduleStage(uint32_t first, uint32_t last)
+    {
+        if(m_jobSystem.GetWorkerCount() == 0)
         {
-            if(destArchetype->count == destArchetype->capacity)
+            for(uint32_t idx = first; idx < last; idx++)
             {
-                GrowArchetype(*destArchetype);
+                SystemCallback& sc = m_systemStore.store[m_schedule.store[idx]];
+
+                RunQuery(sc.query, sc);
             }
 
-            for(uint32_t idx = 0; idx < srcArchetype->components.count; idx++)
-            {
-                int32_t srcColIdx = srcArchetype->componentMap[idx];
+            return;
+        }
 
-                if(srcColIdx == -1)
+        //systems of the same stage do not conflict, run all of them at once
+        uint32_t jobCount = 0;
+
+        for(uint32_t idx = first; idx < last; idx++)
+        {
+            SystemCallback& sc = m_systemStore.store[m_schedule.store[idx]];
+
+            //sorted before the jobs start, systems of the stage may share the query
+            if(sc.flags & SYSTEM_CASCADE)
+            {
+                SortCascadeOrder(sc.query);
+                ++jobCount;
+            }
+            else if(sc.flags & SYSTEM_PARALLEL)
+            {
+                for(uint32_t aIdx = 0; aIdx < sc.query->archetypes.count; aIdx++)
                 {
-                    continue;
+                    Archetype* archetype = sc.query->archetypes.store[aIdx];
+                    jobCount += archetype->GetChunkIndex(archetype->count + archetype->GetChunkCapacity() - 1);
                 }
+            }
+            else
+            {
+                ++jobCount;
+            }
+        }
 
-                Column& srcCol = srcArchetype->columns[srcColIdx];
-                TypeInfo& ti = *srcCol.typeInfo;
-                void* src = OFFSET(srcCol.data, ti.size * r.row);
+        if(jobCount == 0)
+        {
+            return;
+        }
 
+        SystemJob* systemJobs = PTR_CAST(m_wAllocator.Alloc(sizeof(SystemJob) * jobCount), SystemJob);
+        Job* jobs = PTR_CAST(m_wAllocator.Alloc(sizeof(Job) * jobCount), Job);
+        std::atomic<uint32_t> counter(jobCount);
 
-                int32_t destIdx = destArchetype->components.Search(srcArchetype->components.idArr[idx]);
-                if(destIdx != -1)
-                {
-                    int32_t destColIdx = destArchetype->componentMap[destIdx];
+        uint32_t jobIdx = 0;
 
-                    assert(destColIdx != -1);
+        for(uint32_t idx = first; idx < last; idx++)
+        {
+            SystemCallback& sc = m_systemStore.store[m_schedule.store[idx]];
 
-                    Column& destCol = destArchetype->columns[destColIdx];
-                    void* dest = OFFSET(destCol.data, ti.size * destArchetype->count);
+            if((sc.flags & SYSTEM_PARALLEL) && !(sc.flags & SYSTEM_CASCADE))
+            {
+                //one job per chunk, which splits large archetypes into row ranges
+                for(uint32_t aIdx = 0; aIdx < sc.query->archetypes.count; aIdx++)
+                {
+                    Archetype* archetype = sc.query->archetypes.store[aIdx];
 
-                    if(ti.hook.moveCtor)
-                    {
-                        ti.hook.moveCtor(dest, src);
-                    }
-                    else if(ti.hook.copyCtor)
+                    for(uint32_t chunkIdx = 0; archetype->GetChunkCount(chunkIdx) > 0; chunkIdx++)
                     {
-                        ti.hook.copyCtor(dest, src);
+                        systemJobs[jobIdx] = SystemJob{this, &sc, aIdx, chunkIdx};
+                        ++jobIdx;
                     }
-                    else
-                    {
-                        std::memcpy(dest, src, ti.size);
-                    }
-                }
-
-                if(ti.hook.dtor)
-                {
-                    ti.hook.dtor(src);
                 }
             }
+            else
+            {
+                systemJobs[jobIdx] = SystemJob{this, &sc, SystemJobWholeQuery, 0};
+                ++jobIdx;
+            }
+        }
 
-            destArchetype->entities[destArchetype->count] = eId;
-            --r.archetype->count;
-            r.archetype = destArchetype;
-            r.row = destArchetype->count;
-            ++destArchetype->count;
+        assert(jobIdx == jobCount);
+
+        for(uint32_t idx = 0; idx < jobCount; idx++)
+        {
+            jobs[idx].func = RunSystemJob;
+            jobs[idx].data = &systemJobs[idx];
+            jobs[idx].counter = &counter;
         }
 
+        m_jobSystem.Schedule(jobs, jobCount);
+        m_jobSystem.Wait(counter);
 
+        m_wAllocator.Free(sizeof(Job) * jobCount, jobs);
+        m_wAllocator.Free(sizeof(SystemJob) * jobCount, systemJobs);
     }
-    
+
     void World::Progress(double dt)
     {
         if(m_isDefered == false)
         {
-            m_isDefered = true;
-
-            for(uint32_t idx = 0; idx < m_systemStore.count; idx++)
+            if(m_isScheduleDirty)
             {
-                SystemCallback& sc = m_systemStore.store[idx];
-
-                ArchetypeLinkedList* head = sc.archetypeList;
+                BuildSchedule();
+            }
 
-                void** componentsData = PTR_CAST(m_wAllocator.Alloc(sizeof(void*) * sc.components.count), void*);
+            m_isDefered = true;
+            m_nextFreeId = std::max(m_nextFreeId, m_entityIndex.GetMaxId());
+            m_deferredNextId.store(m_nextFreeId, std::memory_order_relaxed);
 
-                while(head->archetype)
-                {
-                    Archetype* archetype = head->archetype;
+            uint32_t stageFirst = 0;
 
-                    for(uint32_t row = 0; row < archetype->count; row++)
-                    {
-                        QueryIterator it;
-                        it.archetype = archetype;
-                        it.world = this;
-                        it.row = row;
+            for(uint32_t stage = 0; stage < m_scheduleStages.count; stage++)
+            {
+                uint32_t stageLast = m_scheduleStages.store[stage];
 
-                        for(uint32_t idx = 0; idx < sc.components.count; idx++)
-                        {
-                            int32_t cIdx = archetype->components.Search(sc.components.idArr[idx]);
-
-                            if(cIdx == -1)
-                            {
-                                cIdx = archetype->components.SearchPair(sc.components.idArr[idx]);
-                            }
-
-                            assert(cIdx != -1);
-
-                            int32_t colIdx = archetype->componentMap[cIdx];
-
-                            if(colIdx == -1)
-                            {
-                                componentsData[idx] = nullptr;
-                            }
-                            else
-                            {
-                                Column& col = archetype->columns[colIdx];
-                                TypeInfo& ti = *col.typeInfo;
-                                void* comData = OFFSET(col.data, ti.size * row);
-                                componentsData[idx] = comData;
-                            }
-                        }
+                //writes of earlier stages are older than this stage, the ones of later stages newer
+                ++m_changeTick;
 
-                        //EXECUTE
-                        sc.Execute(&it, componentsData);
-                    }
+                RunScheduleStage(stageFirst, stageLast);
 
-                    head = head->next;
+                for(uint32_t idx = stageFirst; idx < stageLast; idx++)
+                {
+                    m_systemStore.store[m_schedule.store[idx]].lastRunTick = m_changeTick;
                 }
 
-                m_wAllocator.Free(sizeof(void*) * sc.components.count, componentsData);
+                stageFirst = stageLast;
             }
 
+            //merged commands and writes until the next frame are newer than every run
+            ++m_changeTick;
+
             m_isDefered = false;
+
+            MergeCommandBuffers();
+            FlushEvents();
         }
     }
 
     void World::Destroy()
     {
+        DestroyCommandBuffers();
+        m_mergedCommands.Destroy(m_wAllocator);
+        m_jobSystem.Destroy();
+
         //clear archetype
         for(uint32_t aIdx = 1; aIdx <= m_archetypes.GetCount(); aIdx++)
         {
@@ -1027,33 +3968,58 @@ namespace ECS
 
             for(uint32_t cIdx = 0; cIdx < archetype->columnCount; cIdx++)
             {
-                Column& col = archetype->columns[cIdx];
-                TypeInfo& ti = *col.typeInfo;
+                TypeInfo& ti = *archetype->columns[cIdx].typeInfo;
 
                 if(ti.hook.dtor)
                 {
                     for(uint32_t row = 0; row < archetype->count; row++)
                     {
-                        void* component = OFFSET(col.data, (ti.size * row));
-
-                        ti.hook.dtor(component);
+                        ti.hook.dtor(archetype->GetColumnData(cIdx, row));
                     }
                 }
-
-                m_wAllocator.Free(ti.size * archetype->capacity, col.data);
             }
 
-            m_wAllocator.Free(sizeof(EntityId) * archetype->capacity, archetype->entities);
-            m_wAllocator.Free(sizeof(int32_t) * archetype->components.count * 2, archetype->componentMap);
-            m_wAllocator.Free(sizeof(Column) * archetype->components.count, archetype->columns);
-            archetype->addEdges.Destroy();
-            archetype->removeEdges.Destroy();
+            FreeArchetype(*archetype);
         }
 
 
 
+        for(uint32_t sIdx = 1; sIdx <= m_sparseStorages.GetCount(); sIdx++)
+        {
+            SparseStorage* storage = *m_sparseStorages.GetPageData(m_sparseStorages.GetId(sIdx));
+            TypeInfo& ti = *storage->typeInfo;
+
+            if(storage->data)
+            {
+                if(ti.hook.dtor)
+                {
+                    for(uint32_t slot = 0; slot < storage->GetCount(); slot++)
+                    {
+                        ti.hook.dtor(storage->GetData(slot));
+                    }
+                }
+
+                storage->arena.Destroy();
+            }
+
+            storage->entities.Destroy(m_wAllocator);
+            storage->index.Destroy();
+            m_wAllocator.Free(sizeof(SparseStorage), storage);
+        }
+
         m_archetypes.Destroy();
         m_entityIndex.Destroy();
+        m_denseIndices.Destroy();
+        m_sparseStorages.Destroy();
+
+        //large stores are not owned by a block allocator, every record frees its own
+        for(auto it = m_componentIndex.Begin(); it != m_componentIndex.End(); ++it)
+        {
+            if(it.IsValid())
+            {
+                it.GetValue().archetypeStore.Destroy(m_wAllocator);
+            }
+        }
 
         //NOTE: should clear the data if keeping metadata between world is favorable 
         m_componentIndex.Destroy();
@@ -1062,35 +4028,53 @@ namespace ECS
         m_typeInfos.Destroy();
 
         m_allocators.archetypes.Destroy();
-        m_componentStore.Destroy(m_wAllocator);
-
-        for(uint32_t sIdx = 0; sIdx < m_systemStore.count; sIdx++)
-        {
-            SystemCallback& sc = m_systemStore.store[sIdx];
-            ArchetypeLinkedList* head = sc.archetypeList;
+        m_allocators.chunks.Destroy();
 
-            while(head->archetype)
-            {
-                ArchetypeLinkedList* freeNode = head;
-                head = head->next;
+        m_systemStore.Destroy(m_wAllocator);
+        m_schedule.Destroy(m_wAllocator);
+        m_scheduleStages.Destroy(m_wAllocator);
 
-                ArchetypeLinkedList::Free(m_wAllocator, freeNode);
-            }
+        for(uint32_t qIdx = 0; qIdx < m_queryStore.count; qIdx++)
+        {
+            Query* query = m_queryStore.store[qIdx];
+
+            query->terms.Free(m_wAllocator);
+            query->archetypes.Destroy(m_wAllocator);
+            query->columns.Destroy(m_wAllocator);
+            query->toggles.Destroy(m_wAllocator);
+            query->cascadeOrder.Destroy(m_wAllocator);
+            m_wAllocator.Free(sizeof(Query), query);
+        }
+        m_queryCache.Destroy();
+        m_queryStore.Destroy(m_wAllocator);
 
-            sc.components.Free(m_wAllocator);
+        for(uint32_t bIdx = 0; bIdx < m_eventBuffers.count; bIdx++)
+        {
+            m_eventBuffers.store[bIdx].entities.Destroy(m_wAllocator);
+            m_eventBuffers.store[bIdx].observers.Destroy(m_wAllocator);
+            m_eventBuffers.store[bIdx].queryBuffers.Destroy(m_wAllocator);
         }
-        m_systemStore.Destroy(m_wAllocator);
 
-        for(uint32_t bIdx = 1; bIdx <= m_wAllocator.m_sparse.GetCount(); bIdx++)
+        for(uint32_t type = 0; type < EventTypeCount; type++)
         {
-            BlockAllocator* ba = m_wAllocator.m_sparse.GetPageData(m_wAllocator.m_sparse.GetId(bIdx));
-            assert(ba);
+            m_eventBufferIndex[type].Destroy();
+        }
 
-            ba->Destroy();
+        m_eventBuffers.Destroy(m_wAllocator);
+        m_flushedEvents.Destroy(m_wAllocator);
+
+        for(uint32_t qIdx = 0; qIdx < m_queryEventBuffers.count; qIdx++)
+        {
+            m_queryEventBuffers.store[qIdx].entities.Destroy(m_wAllocator);
         }
 
-        m_wAllocator.m_sparse.Destroy();
-        m_wAllocator.m_chunks.Destroy();
+        m_queryEventBuffers.Destroy(m_wAllocator);
+
+        m_destroyQueue.Destroy(m_wAllocator);
+        m_deferredDestroys.Destroy(m_wAllocator);
+        m_droppedPairs.Destroy(m_wAllocator);
+
+        m_wAllocator.Destroy();
     }
 
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+#include <chrono>
+#include "ecs.h"
+#include "world.h"
+
+struct BenchAllocJob
+{
+    ECS::WorldAllocator* allocator;
+    std::mutex* globalLock; //set for the legacy path, every size class behind one lock
+    void** slots;
+    uint32_t count;
+    bool isAlloc;
+};
+
+inline uint32_t BenchAllocSize(uint32_t i)
+{
+    return 16u << (i % 6);
+}
+
+inline void RunBenchAllocJob(void* data)
+{
+    BenchAllocJob& job = *PTR_CAST(data, BenchAllocJob);
+
+    for(uint32_t i = 0; i < job.count; i++)
+    {
+        uint32_t size = BenchAllocSize(i);
+
+        if(job.globalLock)
+        {
+            std::lock_guard<std::mutex> lock(*job.globalLock);
+            ECS::BlockAllocator* block = job.allocator->GetOrCreateBalloc(size);
+
+            if(job.isAlloc)
+            {
+                job.slots[i] = block->Alloc();
+            }
+            else
+            {
+                block->Free(job.slots[i]);
+            }
+        }
+        else if(job.isAlloc)
+        {
+            job.slots[i] = job.allocator->Alloc(size);
+        }
+        else
+        {
+            job.allocator->Free(size, job.slots[i]);
+        }
+
+        if(job.isAlloc)
+        {
+            *PTR_CAST(job.slots[i], uint8_t) = 1;
+        }
+    }
+}
+
+//every round allocates on all threads, then frees the slots of a neighbour job, so most frees cross threads
+inline double RunBenchAllocRounds(ECS::World* world, std::mutex* globalLock, void** slots,
+    uint32_t jobCount, uint32_t perJob, uint32_t rounds)
+{
+    using namespace ECS;
+
+    std::vector<BenchAllocJob> allocJobs(jobCount);
+    std::vector<Job> jobs(jobCount);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for(uint32_t round = 0; round < rounds; round++)
+    {
+        for(uint32_t phase = 0; phase < 2; phase++)
+        {
+            std::atomic<uint32_t> counter(jobCount);
+
+            for(uint32_t idx = 0; idx < jobCount; idx++)
+            {
+                uint32_t slotJob = phase == 0 ? idx : (idx + 1) % jobCount;
+
+                allocJobs[idx] = BenchAllocJob{&world->m_wAllocator, globalLock,
+                    slots + slotJob * perJob, perJob, phase == 0};
+                jobs[idx] = Job{RunBenchAllocJob, &allocJobs[idx], &counter};
+            }
+
+            world->m_jobSystem.Schedule(jobs.data(), jobCount);
+            world->m_jobSystem.Wait(counter);
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    return double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+void inline BenchWorldAllocator()
+{
+    using namespace ECS;
+
+    constexpr uint32_t workerCount = 7;
+    constexpr uint32_t jobCount = 64;
+    constexpr uint32_t perJob = 2048;
+    constexpr uint32_t rounds = 20;
+
+    World* world = CreateWorld();
+    world->SetWorkerCount(workerCount);
+
+    std::vector<void*> slots(jobCount * perJob);
+    std::mutex globalLock;
+
+    //warm up so both paths start with their blocks created
+    RunBenchAllocRounds(world, nullptr, slots.data(), jobCount, perJob, 1);
+
+    double ns = RunBenchAllocRounds(world, nullptr, slots.data(), jobCount, perJob, rounds);
+    double legacyNs = RunBenchAllocRounds(world, &globalLock, slots.data(), jobCount, perJob, rounds);
+
+    double opCount = double(jobCount) * perJob * rounds * 2;
+
+    std::cout << "Threads " << workerCount + 1 << std::endl;
+    std::cout << "ns per alloc/free " << ns / opCount << " global lock " << legacyNs / opCount << std::endl;
+
+    DestroyWorld(world);
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <chrono>
+#include "ecs.h"
+#include "world.h"
+
+struct BenchRelation {};
+ECS_COMPONENT(BenchRelation)
+
+//sum of id hashes divided by count, the archetype key hash before ordered hashing
+inline uint64_t LegacyComponentSetHash(const ECS::ComponentSet& set)
+{
+    uint64_t h = 0;
+    for(uint32_t i = 0; i < set.count; i++)
+    {
+        h += ECS::HashU64(set.idArr[i]);
+    }
+
+    return set.count ? h / set.count : 0;
+}
+
+struct LegacyArchetypeKey
+{
+    ECS::ComponentSet set;
+
+    bool operator==(const LegacyArchetypeKey& other) const
+    {
+        if(set.count != other.set.count)
+        {
+            return false;
+        }
+
+        return std::memcmp(set.idArr, other.set.idArr, sizeof(ECS::EntityId) * set.count) == 0;
+    }
+};
+
+namespace ECS
+{
+    template<>
+    struct Hash<LegacyArchetypeKey>
+    {
+        static uint64_t Value(const LegacyArchetypeKey& v)
+        {
+            return LegacyComponentSetHash(v.set);
+        }
+    };
+}
+
+void inline BenchArchetypeLookup()
+{
+    using namespace ECS;
+
+    constexpr uint32_t targetCount = 64;
+    constexpr uint32_t archetypeCount = 10000;
+    constexpr uint32_t lookupRounds = 100;
+
+    World* world = CreateWorld();
+    world->Pair<BenchRelation>(false).Register();
+
+    EntityId pairs[targetCount];
+    for(uint32_t i = 0; i < targetCount; i++)
+    {
+        Entity target = world->CreateEntity();
+        pairs[i] = world->RegisterPair(ComponentTypeId<BenchRelation>::id, target.GetFullId());
+    }
+
+    //every archetype is 3 to 5 relationship pairs, built through add edges
+    uint64_t seed = 0x1234;
+    while(world->m_archetypes.GetCount() < archetypeCount)
+    {
+        seed = HashU64(seed);
+        uint32_t termCount = 3 + seed % 3;
+
+        Archetype* archetype = nullptr;
+        for(uint32_t t = 0; t < termCount; t++)
+        {
+            EntityId pairId = pairs[(seed >> (t * 8)) % targetCount];
+
+            if(archetype && archetype->components.Has(pairId))
+            {
+                continue;
+            }
+
+            archetype = world->GetOrCreateArchetype_Add(archetype, pairId);
+        }
+    }
+
+    //lookup keys are copies, the same way GetOrCreateArchetype_Add builds them
+    std::vector<ComponentSet> keys;
+    HashMap<LegacyArchetypeKey, Archetype*> legacyMap;
+    legacyMap.Init(&world->m_wAllocator, 8);
+
+    for(uint32_t aIdx = 1; aIdx <= world->m_archetypes.GetCount(); aIdx++)
+    {
+        Archetype* archetype = world->m_archetypes.GetPageData(world->m_archetypes.GetId(aIdx));
+
+        ComponentSet key;
+        key.Alloc(world->m_wAllocator, archetype->components.count);
+        key.count = archetype->components.count;
+        std::memcpy(key.idArr, archetype->components.idArr, sizeof(EntityId) * key.count);
+        keys.push_back(key);
+
+        legacyMap.Insert(LegacyArchetypeKey{archetype->components}, archetype);
+    }
+
+    //every lookup builds its key first, as GetOrCreateArchetype_Add does for a new edge
+    uint32_t found = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for(uint32_t round = 0; round < lookupRounds; round++)
+    {
+        for(ComponentSet& key : keys)
+        {
+            ComponentSet lookup;
+            lookup.Alloc(world->m_wAllocator, key.count);
+            lookup.count = key.count;
+            std::memcpy(lookup.idArr, key.idArr, sizeof(EntityId) * key.count);
+
+            found += world->GetArchetype(lookup) != nullptr;
+
+            lookup.Free(world->m_wAllocator);
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    uint32_t legacyFound = 0;
+    auto legacyStart = std::chrono::high_resolution_clock::now();
+
+    for(uint32_t round = 0; round < lookupRounds; round++)
+    {
+        for(ComponentSet& key : keys)
+        {
+            LegacyArchetypeKey lookup;
+            lookup.set.idArr = PTR_CAST(world->m_wAllocator.Alloc(sizeof(EntityId) * key.count), EntityId);
+            lookup.set.count = key.count;
+            std::memcpy(lookup.set.idArr, key.idArr, sizeof(EntityId) * key.count);
+
+            legacyFound += legacyMap.TryGetValue(lookup) != nullptr;
+
+            world->m_wAllocator.Free(sizeof(EntityId) * key.count, lookup.set.idArr);
+        }
+    }
+
+    auto legacyEnd = std::chrono::high_resolution_clock::now();
+
+    std::unordered_set<uint64_t> hashes;
+    std::unordered_set<uint64_t> legacyHashes;
+    for(ComponentSet& key : keys)
+    {
+        hashes.insert(key.Hash());
+        legacyHashes.insert(LegacyComponentSetHash(key));
+    }
+
+    double lookupCount = double(keys.size() * lookupRounds);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    auto legacyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(legacyEnd - legacyStart).count();
+
+    std::cout << "Archetypes " << keys.size() << std::endl;
+    std::cout << "Found " << found << " legacy " << legacyFound << std::endl;
+    std::cout << "ns per lookup " << ns / lookupCount << " legacy " << legacyNs / lookupCount << std::endl;
+    std::cout << "Distinct hashes " << hashes.size() << " legacy " << legacyHashes.size() << std::endl;
+
+    for(ComponentSet& key : keys)
+    {
+        key.Free(world->m_wAllocator);
+    }
+
+    legacyMap.Destroy();
+    DestroyWorld(world);
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <utility>
+#include "ecs.h"
+#include "world.h"
+
+//N distinct components of one uint32_t, shared by the benches that need many component types
+template<uint32_t N>
+struct BenchComponent
+{
+    uint32_t v;
+};
+
+namespace ECS
+{
+    template<uint32_t N>
+    struct ComponentName<BenchComponent<N>>
+    {
+        static constexpr const char* name = "BenchComponent";
+    };
+}
+
+template<uint32_t... N>
+inline void RegisterBenchComponents(ECS::World* world, ECS::EntityId* ids, std::integer_sequence<uint32_t, N...>)
+{
+    ((world->Component<BenchComponent<N>>().Register(),
+      ids[N] = ECS::ComponentTypeId<BenchComponent<N>>::id), ...);
+}
@@ -0,0 +1,45 @@
+#include "allocator/world_allocator_bench.h"
+#include "archetype_lookup/archetype_lookup_bench.h"
+#include "component_get/component_get_bench.h"
+#include "query_match/query_match_bench.h"
+#include "soa_iteration/soa_iteration_bench.h"
+
+struct BenchEntry
+{
+    const char* name;
+    void (*func)();
+};
+
+//component type ids are static per process, so only one bench runs per process
+static constexpr BenchEntry BenchEntries[] =
+{
+    {"world_allocator", BenchWorldAllocator},
+    {"archetype_lookup", BenchArchetypeLookup},
+    {"component_get", BenchComponentGet},
+    {"query_match", BenchQueryMatch},
+    {"soa_iteration", BenchSoaIteration},
+};
+
+int main(int argc, char** argv)
+{
+    if(argc == 2)
+    {
+        for(const BenchEntry& entry : BenchEntries)
+        {
+            if(std::strcmp(argv[1], entry.name) == 0)
+            {
+                entry.func();
+                return 0;
+            }
+        }
+    }
+
+    std::cout << "Usage: ecs-bench <bench>" << std::endl;
+
+    for(const BenchEntry& entry : BenchEntries)
+    {
+        std::cout << "    " << entry.name << std::endl;
+    }
+
+    return 1;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <chrono>
+#include "ecs.h"
+#include "world.h"
+#include "../bench_fixture.h"
+
+//component lookup used by World::Get before the dense column map
+inline void* LegacyGet(ECS::World* world, ECS::EntityId eId, ECS::EntityId cId)
+{
+    ECS::EntityRecord* r = world->m_entityIndex.GetPageData(eId);
+
+    int32_t idx = r->archetype->components.Search(cId);
+    int32_t colIdx = r->archetype->componentMap[idx];
+
+    return r->archetype->GetColumnData(colIdx, r->row);
+}
+
+void inline BenchComponentGet()
+{
+    using namespace ECS;
+
+    constexpr uint32_t componentCount = 16;
+    constexpr uint32_t entityCount = 100000;
+    constexpr uint32_t rounds = 10;
+
+    World* world = CreateWorld();
+
+    EntityId ids[componentCount];
+    RegisterBenchComponents(world, ids, std::make_integer_sequence<uint32_t, componentCount>());
+
+    ComponentSet set;
+    set.Alloc(world->m_wAllocator, componentCount);
+    set.count = componentCount;
+    std::memcpy(set.idArr, ids, sizeof(EntityId) * componentCount);
+    set.Sort();
+
+    EntityId first = world->CreateEntities(entityCount, set);
+    set.Free(world->m_wAllocator);
+
+    //distinct values so both sums check the lookups land on the right column and row
+    for(uint32_t i = 0; i < entityCount; i++)
+    {
+        for(uint32_t c = 0; c < componentCount; c++)
+        {
+            PTR_CAST(world->Get(first + i, ids[c]), uint32_t)[0] = i * componentCount + c + 1;
+        }
+    }
+
+    //entities in order with a random component, so the lookup is what gets measured
+    uint64_t sum = 0;
+    uint64_t seed = 0x5678;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for(uint32_t round = 0; round < rounds; round++)
+    {
+        for(uint32_t i = 0; i < entityCount; i++)
+        {
+            seed = HashU64(seed);
+            sum += PTR_CAST(world->Get(first + i, ids[(seed >> 32) % componentCount]), uint32_t)[0];
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    uint64_t legacySum = 0;
+    seed = 0x5678;
+    auto legacyStart = std::chrono::high_resolution_clock::now();
+
+    for(uint32_t round = 0; round < rounds; round++)
+    {
+        for(uint32_t i = 0; i < entityCount; i++)
+        {
+            seed = HashU64(seed);
+            legacySum += PTR_CAST(LegacyGet(world, first + i, ids[(seed >> 32) % componentCount]), uint32_t)[0];
+        }
+    }
+
+    auto legacyEnd = std::chrono::high_resolution_clock::now();
+
+    double getCount = double(entityCount) * rounds;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    auto legacyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(legacyEnd - legacyStart).count();
+
+    std::cout << "Sum " << sum << " legacy " << legacySum << std::endl;
+    std::cout << "ns per get " << ns / getCount << " legacy " << legacyNs / getCount << std::endl;
+
+    DestroyWorld(world);
+}
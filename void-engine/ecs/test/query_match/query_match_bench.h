@@ -0,0 +1,122 @@
+#pragma once
+#include <chrono>
+#include "ecs.h"
+#include "world.h"
+#include "../bench_fixture.h"
+
+//term loop used by Query::Match before archetype signatures
+inline bool LegacyQueryMatch(ECS::Query* query, ECS::Archetype* archetype)
+{
+    for(uint32_t idx = 0; idx < query->terms.count; idx++)
+    {
+        if(!archetype->components.Has(query->terms.idArr[idx]) &&
+           !archetype->components.HasPair(query->terms.idArr[idx]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void inline BenchQueryMatch()
+{
+    using namespace ECS;
+
+    constexpr uint32_t componentCount = 32;
+    constexpr uint32_t archetypeCount = 10000;
+    constexpr uint32_t queryCount = 64;
+
+    World* world = CreateWorld();
+
+    EntityId ids[componentCount];
+    RegisterBenchComponents(world, ids, std::make_integer_sequence<uint32_t, componentCount>());
+
+    //every archetype is 4 to 11 components
+    uint64_t seed = 0x4321;
+    while(world->m_archetypes.GetCount() < archetypeCount)
+    {
+        seed = HashU64(seed);
+        uint32_t termCount = 4 + seed % 8;
+
+        Archetype* archetype = nullptr;
+        for(uint32_t t = 0; t < termCount; t++)
+        {
+            EntityId cId = ids[(seed >> (t * 5)) % componentCount];
+
+            if(archetype && archetype->components.Has(cId))
+            {
+                continue;
+            }
+
+            archetype = world->GetOrCreateArchetype_Add(archetype, cId);
+        }
+    }
+
+    //queries of 2 to 4 terms, created after the archetypes so the timing below is the only matching
+    std::vector<Query*> queries;
+    for(uint32_t q = 0; q < queryCount; q++)
+    {
+        seed = HashU64(seed);
+        ComponentSet terms;
+        terms.Alloc(world->m_wAllocator, 4);
+        terms.count = 0;
+
+        uint32_t termCount = 2 + seed % 3;
+        for(uint32_t t = 0; t < termCount; t++)
+        {
+            EntityId cId = ids[(seed >> (t * 5 + 8)) % componentCount];
+
+            if(!terms.Has(cId))
+            {
+                terms.idArr[terms.count++] = cId;
+                terms.Sort();
+            }
+        }
+
+        queries.push_back(world->CreateQuery(terms.idArr, terms.count));
+        terms.Free(world->m_wAllocator);
+    }
+
+    std::vector<Archetype*> archetypes;
+    for(uint32_t aIdx = 1; aIdx <= world->m_archetypes.GetCount(); aIdx++)
+    {
+        archetypes.push_back(world->m_archetypes.GetPageData(world->m_archetypes.GetId(aIdx)));
+    }
+
+    uint32_t matched = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for(Query* query : queries)
+    {
+        for(Archetype* archetype : archetypes)
+        {
+            matched += query->Match(archetype);
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    uint32_t legacyMatched = 0;
+    auto legacyStart = std::chrono::high_resolution_clock::now();
+
+    for(Query* query : queries)
+    {
+        for(Archetype* archetype : archetypes)
+        {
+            legacyMatched += LegacyQueryMatch(query, archetype);
+        }
+    }
+
+    auto legacyEnd = std::chrono::high_resolution_clock::now();
+
+    double matchCount = double(queries.size() * archetypes.size());
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    auto legacyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(legacyEnd - legacyStart).count();
+
+    std::cout << "Archetypes " << archetypes.size() << " queries " << queries.size() << std::endl;
+    std::cout << "Matched " << matched << " legacy " << legacyMatched << std::endl;
+    std::cout << "ns per match " << ns / matchCount << " legacy " << legacyNs / matchCount << std::endl;
+
+    DestroyWorld(world);
+}
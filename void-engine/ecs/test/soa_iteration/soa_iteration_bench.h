@@ -0,0 +1,78 @@
+#pragma once
+#include <chrono>
+#include "ecs.h"
+#include "world.h"
+
+struct BenchSoaPosition { float x, y, z; };
+struct BenchSoaVelocity { float x, y, z; };
+struct BenchAosPosition { float x, y, z; };
+struct BenchAosVelocity { float x, y, z; };
+ECS_COMPONENT(BenchSoaPosition)
+ECS_COMPONENT(BenchSoaVelocity)
+ECS_COMPONENT(BenchAosPosition)
+ECS_COMPONENT(BenchAosVelocity)
+ECS_SOA(BenchSoaPosition, x, y, z)
+ECS_SOA(BenchSoaVelocity, x, y, z)
+
+inline void BenchIntegrateSoa(ECS::Soa<BenchSoaPosition> p, ECS::Soa<const BenchSoaVelocity> v)
+{
+    //plain float streams, the loop is vectorized by the compiler
+    for(uint32_t i = 0; i < p.count; i++)
+    {
+        p.x[i] += v.x[i];
+        p.y[i] += v.y[i];
+        p.z[i] += v.z[i];
+    }
+}
+
+inline void BenchIntegrateAos(BenchAosPosition& p, const BenchAosVelocity& v)
+{
+    p.x += v.x;
+    p.y += v.y;
+    p.z += v.z;
+}
+
+void inline BenchSoaIteration()
+{
+    using namespace ECS;
+
+    constexpr uint32_t entityCount = 100000;
+    constexpr uint32_t frames = 100;
+
+    World* world = CreateWorld();
+    world->Component<BenchSoaPosition>().Register();
+    world->Component<BenchSoaVelocity>().Register();
+    world->Component<BenchAosPosition>().Register();
+    world->Component<BenchAosVelocity>().Register();
+
+    world->CreateEntities<BenchSoaPosition, BenchSoaVelocity>(entityCount,
+        BenchSoaPosition{0, 0, 0}, BenchSoaVelocity{1, 2, 3});
+    world->CreateEntities<BenchAosPosition, BenchAosVelocity>(entityCount,
+        BenchAosPosition{0, 0, 0}, BenchAosVelocity{1, 2, 3});
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for(uint32_t frame = 0; frame < frames; frame++)
+    {
+        world->Each<BenchSoaPosition, BenchSoaVelocity>(BenchIntegrateSoa);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto aosStart = std::chrono::high_resolution_clock::now();
+
+    for(uint32_t frame = 0; frame < frames; frame++)
+    {
+        world->Each<BenchAosPosition, BenchAosVelocity>(BenchIntegrateAos);
+    }
+
+    auto aosEnd = std::chrono::high_resolution_clock::now();
+
+    double rowCount = double(entityCount) * frames;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    auto aosNs = std::chrono::duration_cast<std::chrono::nanoseconds>(aosEnd - aosStart).count();
+
+    std::cout << "Entities " << entityCount << std::endl;
+    std::cout << "ns per row " << ns / rowCount << " array of structs " << aosNs / rowCount << std::endl;
+
+    DestroyWorld(world);
+}